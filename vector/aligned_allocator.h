@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// AlignedAllocator returns buffers aligned to at least `Alignment` bytes
+// (and to alignof(T)), e.g. a cache line for false-sharing avoidance or a
+// SIMD register width for aligned loads. The allocation size is rounded up
+// to a multiple of the alignment, so a kernel may read whole vectors
+// up to the next aligned boundary past the last element.
+template <typename T, size_t Alignment>
+class AlignedAllocator {
+    static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0, "Alignment must be a power of two");
+
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    static constexpr size_t kAlignment = Alignment > alignof(T) ? Alignment : alignof(T);
+
+    // Needed because allocator_traits cannot rebind a non-type parameter
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>& /*other*/) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > (size_t(-1) - kAlignment) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(::operator new(PaddedBytes(n), std::align_val_t(kAlignment)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        ::operator delete(p, PaddedBytes(n), std::align_val_t(kAlignment));
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>& /*other*/) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>& /*other*/) const noexcept {
+        return false;
+    }
+
+private:
+    static size_t PaddedBytes(size_t n) noexcept {
+        return (n * sizeof(T) + kAlignment - 1) / kAlignment * kAlignment;
+    }
+};
+
+// Shorthand for containers, which rebind it to their element type:
+//     Vector<float, Aligned<64>> samples;
+template <size_t Alignment>
+using Aligned = AlignedAllocator<std::byte, Alignment>;
+
+// True if `ptr` is aligned to `alignment` bytes
+inline bool IsAligned(const void* ptr, size_t alignment) noexcept {
+    return reinterpret_cast<std::uintptr_t>(ptr) % alignment == 0;
+}
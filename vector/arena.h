@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+// MonotonicArena hands out memory by bumping a pointer inside a chain of
+// blocks. Individual deallocations are no-ops; everything is released at
+// once by `Reset` or by the destructor. The most recent allocation can be
+// grown in place while the current block has room, which lets a Vector that
+// is the last user of the arena grow without copying.
+class MonotonicArena {
+public:
+    explicit MonotonicArena(size_t initial_block_size = 4096) noexcept;
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    void* Allocate(size_t bytes, size_t alignment);
+
+    // Extends the allocation at `ptr` from `old_bytes` to `new_bytes`
+    // if it is the latest allocation and the current block has room.
+    bool TryExtend(void* ptr, size_t old_bytes, size_t new_bytes) noexcept;
+
+    // Releases every allocation. The largest block is kept for reuse,
+    // all others are returned to the system.
+    void Reset() noexcept;
+
+    // Number of bytes handed out since construction or the last `Reset`
+    size_t BytesAllocated() const noexcept { return bytes_allocated_; }
+    size_t BlockCount() const noexcept;
+
+    ~MonotonicArena();
+
+private:
+    struct Block {
+        Block* prev;
+        size_t size;
+    };
+
+    static constexpr size_t kHeaderSize =
+        (sizeof(Block) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    void AddBlock(size_t min_bytes);
+    static std::byte* BlockBegin(Block* block) noexcept;
+
+    Block* head_ = nullptr;
+    std::byte* ptr_ = nullptr;
+    std::byte* end_ = nullptr;
+    void* last_allocation_ = nullptr;
+    size_t next_block_size_;
+    size_t bytes_allocated_ = 0;
+};
+
+// Allocator adaptor drawing from a MonotonicArena. It is cheap to copy and
+// propagates with the container, so a Vector and its copies keep using
+// the arena they were created with.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    explicit ArenaAllocator(MonotonicArena& arena) noexcept
+        : arena_(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept
+        : arena_(other.arena_) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* /*p*/, size_t /*n*/) noexcept {}
+
+    // In-place growth hook used by RawMemory::TryExtend
+    bool try_extend(T* p, size_t old_n, size_t new_n) noexcept {
+        return arena_->TryExtend(p, old_n * sizeof(T), new_n * sizeof(T));
+    }
+
+    MonotonicArena& Arena() const noexcept { return *arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ == other.arena_;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ != other.arena_;
+    }
+
+private:
+    template <typename U>
+    friend class ArenaAllocator;
+
+    MonotonicArena* arena_;
+};
+
+
+// Implementation of MonotonicArena methods
+
+
+inline MonotonicArena::MonotonicArena(size_t initial_block_size) noexcept
+    : next_block_size_(std::max<size_t>(initial_block_size, 64)) {}
+
+inline void* MonotonicArena::Allocate(size_t bytes, size_t alignment) {
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    auto aligned = [&]() {
+        auto address = reinterpret_cast<uintptr_t>(ptr_);
+        return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(alignment - 1));
+    };
+    std::byte* result = aligned();
+    if (ptr_ == nullptr || result > end_ || static_cast<size_t>(end_ - result) < bytes) {
+        AddBlock(bytes + alignment);
+        result = aligned();
+    }
+    ptr_ = result + bytes;
+    last_allocation_ = result;
+    bytes_allocated_ += bytes;
+    return result;
+}
+
+inline bool MonotonicArena::TryExtend(void* ptr, size_t old_bytes, size_t new_bytes) noexcept {
+    auto* start = static_cast<std::byte*>(ptr);
+    if (ptr == nullptr || ptr != last_allocation_ || start + old_bytes != ptr_) {
+        return false;
+    }
+    if (new_bytes > old_bytes && static_cast<size_t>(end_ - start) < new_bytes) {
+        return false;
+    }
+    ptr_ = start + new_bytes;
+    bytes_allocated_ = bytes_allocated_ - old_bytes + new_bytes;
+    return true;
+}
+
+inline void MonotonicArena::Reset() noexcept {
+    Block* largest = head_;
+    for (Block* block = head_; block != nullptr; block = block->prev) {
+        if (block->size > largest->size) {
+            largest = block;
+        }
+    }
+    while (head_ != nullptr) {
+        Block* prev = head_->prev;
+        if (head_ != largest) {
+            operator delete(head_);
+        }
+        head_ = prev;
+    }
+    head_ = largest;
+    if (head_ != nullptr) {
+        head_->prev = nullptr;
+        ptr_ = BlockBegin(head_);
+        end_ = ptr_ + head_->size;
+    } else {
+        ptr_ = end_ = nullptr;
+    }
+    last_allocation_ = nullptr;
+    bytes_allocated_ = 0;
+}
+
+inline size_t MonotonicArena::BlockCount() const noexcept {
+    size_t count = 0;
+    for (Block* block = head_; block != nullptr; block = block->prev) {
+        ++count;
+    }
+    return count;
+}
+
+inline MonotonicArena::~MonotonicArena() {
+    while (head_ != nullptr) {
+        operator delete(std::exchange(head_, head_->prev));
+    }
+}
+
+inline void MonotonicArena::AddBlock(size_t min_bytes) {
+    const size_t size = std::max(next_block_size_, min_bytes);
+    auto* block = static_cast<Block*>(operator new(kHeaderSize + size));
+    block->prev = head_;
+    block->size = size;
+    head_ = block;
+    ptr_ = BlockBegin(block);
+    end_ = ptr_ + size;
+    last_allocation_ = nullptr;
+    next_block_size_ = size * 2;
+}
+
+inline std::byte* MonotonicArena::BlockBegin(Block* block) noexcept {
+    return reinterpret_cast<std::byte*>(block) + kHeaderSize;
+}
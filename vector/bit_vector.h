@@ -0,0 +1,399 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "growth_policy.h"
+#include "raw_memory.h"
+#include "simd_kernels.h"
+
+// BitVector packs booleans into 64-bit words held in RawMemory<uint64_t>,
+// using one bit per flag where Vector<bool> uses a byte. Elements are read
+// as bool and written through proxy references. Whole-vector operations
+// (And/Or/Xor/Not, Count) work a word or a SIMD register at a time, and
+// FindFirst/FindNext and SetBits() skip zero words.
+//
+// Bits past Size() in the last word are kept zero, so word-level results
+// never need masking.
+class BitVector {
+public:
+    class Reference;
+    class SetBitIterator;
+    class SetBitRange;
+
+    static constexpr size_t kWordBits = 64;
+    // Returned by FindFirst/FindNext when there is no set bit
+    static constexpr size_t kNpos = static_cast<size_t>(-1);
+
+    BitVector() = default;
+    explicit BitVector(size_t size, bool value = false);
+    BitVector(const BitVector& other);
+    BitVector(BitVector&& other) noexcept;
+
+    BitVector& operator=(const BitVector& rhs);
+    BitVector& operator=(BitVector&& rhs) noexcept;
+
+    void Swap(BitVector& other) noexcept;
+
+    // Resizes the vector to `new_size` bits; new bits are set to `value`
+    void Resize(size_t new_size, bool value = false);
+
+    // Ensures room for `new_capacity` bits
+    void Reserve(size_t new_capacity);
+
+    void PushBack(bool value);
+    void PopBack() noexcept;
+    void Clear() noexcept;
+
+    bool operator[](size_t index) const noexcept;
+    Reference operator[](size_t index) noexcept;
+
+    void Set(size_t index, bool value = true) noexcept;
+    void Flip(size_t index) noexcept;
+    // Sets every bit to `value`
+    void Fill(bool value) noexcept;
+
+    // Bitwise operations; both vectors must have the same size
+    BitVector& operator&=(const BitVector& other);
+    BitVector& operator|=(const BitVector& other);
+    BitVector& operator^=(const BitVector& other);
+    // Complements every bit
+    BitVector& Flip() noexcept;
+
+    friend BitVector operator&(BitVector lhs, const BitVector& rhs) { return lhs &= rhs; }
+    friend BitVector operator|(BitVector lhs, const BitVector& rhs) { return lhs |= rhs; }
+    friend BitVector operator^(BitVector lhs, const BitVector& rhs) { return lhs ^= rhs; }
+    friend BitVector operator~(BitVector vec) { return std::move(vec.Flip()); }
+
+    bool operator==(const BitVector& other) const noexcept;
+    bool operator!=(const BitVector& other) const noexcept { return !(*this == other); }
+
+    // Number of set bits
+    size_t Count() const noexcept;
+    bool Any() const noexcept { return FindFirst() != kNpos; }
+
+    // Index of the first set bit, or of the first one after `index`
+    size_t FindFirst() const noexcept;
+    size_t FindNext(size_t index) const noexcept;
+
+    // Range over the indices of set bits, in increasing order
+    SetBitRange SetBits() const noexcept;
+
+    size_t Size() const noexcept { return size_; }
+    size_t Capacity() const noexcept { return words_.Capacity() * kWordBits; }
+
+    // Underlying words; bit i is bit i % 64 of word i / 64. Writers must
+    // leave the bits past Size() zero.
+    const uint64_t* Words() const noexcept { return words_.GetAddress(); }
+    uint64_t* Words() noexcept { return words_.GetAddress(); }
+    size_t WordCount() const noexcept { return WordsFor(size_); }
+
+    static size_t WordsFor(size_t bits) noexcept { return (bits + kWordBits - 1) / kWordBits; }
+
+private:
+    RawMemory<uint64_t> words_;
+    size_t size_ = 0;
+
+    static uint64_t Mask(size_t index) noexcept { return uint64_t{1} << (index % kWordBits); }
+
+    // Zeroes the bits past size_ in the last word
+    void ClearTail() noexcept;
+
+    // Moves the words to a buffer of `new_words` >= WordCount() words
+    void Reallocate(size_t new_words);
+};
+
+// Proxy for one bit
+class BitVector::Reference {
+public:
+    Reference(uint64_t* word, uint64_t mask) noexcept : word_(word), mask_(mask) {}
+    Reference(const Reference&) = default;
+
+    operator bool() const noexcept { return (*word_ & mask_) != 0; }
+
+    Reference& operator=(bool value) noexcept {
+        *word_ = value ? *word_ | mask_ : *word_ & ~mask_;
+        return *this;
+    }
+
+    Reference& operator=(const Reference& other) noexcept { return *this = bool(other); }
+
+    void Flip() noexcept { *word_ ^= mask_; }
+
+private:
+    uint64_t* word_;
+    uint64_t mask_;
+};
+
+// Yields the index of each set bit, clearing the lowest bit of a copy of
+// the current word at every step
+class BitVector::SetBitIterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const size_t*;
+    using reference = size_t;
+
+    SetBitIterator() = default;
+    SetBitIterator(const uint64_t* words, size_t word_count, size_t word_index) noexcept;
+
+    size_t operator*() const noexcept {
+        return word_index_ * kWordBits + __builtin_ctzll(word_);
+    }
+
+    SetBitIterator& operator++() noexcept {
+        word_ &= word_ - 1;
+        SkipZeroWords();
+        return *this;
+    }
+
+    SetBitIterator operator++(int) noexcept {
+        SetBitIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const SetBitIterator& other) const noexcept {
+        return word_index_ == other.word_index_ && word_ == other.word_;
+    }
+
+    bool operator!=(const SetBitIterator& other) const noexcept { return !(*this == other); }
+
+private:
+    void SkipZeroWords() noexcept;
+
+    const uint64_t* words_ = nullptr;
+    size_t word_count_ = 0;
+    size_t word_index_ = 0;
+    uint64_t word_ = 0;
+};
+
+class BitVector::SetBitRange {
+public:
+    SetBitRange(const uint64_t* words, size_t word_count) noexcept
+        : words_(words), word_count_(word_count) {}
+
+    SetBitIterator begin() const noexcept { return SetBitIterator(words_, word_count_, 0); }
+    SetBitIterator end() const noexcept { return SetBitIterator(words_, word_count_, word_count_); }
+
+private:
+    const uint64_t* words_;
+    size_t word_count_;
+};
+
+
+// Implementation of BitVector class methods
+
+
+inline BitVector::BitVector(size_t size, bool value) {
+    Resize(size, value);
+}
+
+inline BitVector::BitVector(const BitVector& other)
+    : words_(other.WordCount())
+    , size_(other.size_) {
+    if (size_ != 0) {
+        std::memcpy(words_.GetAddress(), other.Words(), WordCount() * sizeof(uint64_t));
+    }
+}
+
+inline BitVector::BitVector(BitVector&& other) noexcept
+    : words_(std::move(other.words_))
+    , size_(std::exchange(other.size_, 0)) {
+}
+
+inline BitVector& BitVector::operator=(const BitVector& rhs) {
+    if (this != &rhs) {
+        if (rhs.WordCount() > words_.Capacity()) {
+            BitVector copy(rhs);
+            Swap(copy);
+        } else {
+            if (rhs.size_ != 0) {
+                std::memcpy(words_.GetAddress(), rhs.Words(), rhs.WordCount() * sizeof(uint64_t));
+            }
+            size_ = rhs.size_;
+        }
+    }
+    return *this;
+}
+
+inline BitVector& BitVector::operator=(BitVector&& rhs) noexcept {
+    if (this != &rhs) {
+        words_ = std::move(rhs.words_);
+        size_ = std::exchange(rhs.size_, 0);
+    }
+    return *this;
+}
+
+inline void BitVector::Swap(BitVector& other) noexcept {
+    words_.Swap(other.words_);
+    std::swap(size_, other.size_);
+}
+
+inline void BitVector::Resize(size_t new_size, bool value) {
+    const size_t old_words = WordCount();
+    const size_t new_words = WordsFor(new_size);
+    if (new_words > words_.Capacity()) {
+        Reallocate(std::max(new_words, DefaultGrowth::Grow<uint64_t>(words_.Capacity(), new_words)));
+    }
+    if (new_size > size_) {
+        const uint64_t fill = value ? ~uint64_t{0} : 0;
+        if (value && size_ % kWordBits != 0) {
+            words_[old_words - 1] |= fill << (size_ % kWordBits);
+        }
+        std::fill(words_ + old_words, words_ + new_words, fill);
+    }
+    size_ = new_size;
+    ClearTail();
+}
+
+inline void BitVector::Reserve(size_t new_capacity) {
+    const size_t new_words = WordsFor(new_capacity);
+    if (new_words > words_.Capacity()) {
+        Reallocate(new_words);
+    }
+}
+
+inline void BitVector::PushBack(bool value) {
+    if (size_ == Capacity()) {
+        const size_t required = WordCount() + 1;
+        Reallocate(std::max(required, DefaultGrowth::Grow<uint64_t>(words_.Capacity(), required)));
+    }
+    if (size_ % kWordBits == 0) {
+        words_[size_ / kWordBits] = 0;
+    }
+    ++size_;
+    Set(size_ - 1, value);
+}
+
+inline void BitVector::PopBack() noexcept {
+    assert(size_ > 0);
+    --size_;
+    ClearTail();
+}
+
+inline void BitVector::Clear() noexcept {
+    size_ = 0;
+}
+
+inline bool BitVector::operator[](size_t index) const noexcept {
+    assert(index < size_);
+    return (words_[index / kWordBits] & Mask(index)) != 0;
+}
+
+inline BitVector::Reference BitVector::operator[](size_t index) noexcept {
+    assert(index < size_);
+    return Reference(words_ + index / kWordBits, Mask(index));
+}
+
+inline void BitVector::Set(size_t index, bool value) noexcept {
+    (*this)[index] = value;
+}
+
+inline void BitVector::Flip(size_t index) noexcept {
+    (*this)[index].Flip();
+}
+
+inline void BitVector::Fill(bool value) noexcept {
+    std::fill(words_ + 0, words_ + WordCount(), value ? ~uint64_t{0} : 0);
+    ClearTail();
+}
+
+inline BitVector& BitVector::operator&=(const BitVector& other) {
+    assert(size_ == other.size_);
+    Simd::And(Words(), other.Words(), words_.GetAddress(), WordCount());
+    return *this;
+}
+
+inline BitVector& BitVector::operator|=(const BitVector& other) {
+    assert(size_ == other.size_);
+    Simd::Or(Words(), other.Words(), words_.GetAddress(), WordCount());
+    return *this;
+}
+
+inline BitVector& BitVector::operator^=(const BitVector& other) {
+    assert(size_ == other.size_);
+    Simd::Xor(Words(), other.Words(), words_.GetAddress(), WordCount());
+    return *this;
+}
+
+inline BitVector& BitVector::Flip() noexcept {
+    Simd::Not(Words(), words_.GetAddress(), WordCount());
+    ClearTail();
+    return *this;
+}
+
+inline bool BitVector::operator==(const BitVector& other) const noexcept {
+    return size_ == other.size_
+        && (size_ == 0 || std::memcmp(Words(), other.Words(), WordCount() * sizeof(uint64_t)) == 0);
+}
+
+inline size_t BitVector::Count() const noexcept {
+    return Simd::PopCount(Words(), WordCount());
+}
+
+inline size_t BitVector::FindFirst() const noexcept {
+    SetBitIterator it = SetBits().begin();
+    return it == SetBits().end() ? kNpos : *it;
+}
+
+inline size_t BitVector::FindNext(size_t index) const noexcept {
+    const size_t next = index + 1;
+    if (next >= size_) {
+        return kNpos;
+    }
+    size_t word_index = next / kWordBits;
+    uint64_t word = words_[word_index] & (~uint64_t{0} << (next % kWordBits));
+    while (word == 0) {
+        if (++word_index == WordCount()) {
+            return kNpos;
+        }
+        word = words_[word_index];
+    }
+    return word_index * kWordBits + __builtin_ctzll(word);
+}
+
+inline BitVector::SetBitRange BitVector::SetBits() const noexcept {
+    return SetBitRange(Words(), WordCount());
+}
+
+inline void BitVector::ClearTail() noexcept {
+    if (size_ % kWordBits != 0) {
+        words_[size_ / kWordBits] &= Mask(size_) - 1;
+    }
+}
+
+inline void BitVector::Reallocate(size_t new_words) {
+    assert(new_words >= WordCount());
+    RawMemory<uint64_t> new_data(new_words);
+    if (size_ != 0) {
+        std::memcpy(new_data.GetAddress(), Words(), WordCount() * sizeof(uint64_t));
+    }
+    words_.Swap(new_data);
+}
+
+
+// Implementation of BitVector::SetBitIterator class methods
+
+
+inline BitVector::SetBitIterator::SetBitIterator(const uint64_t* words, size_t word_count, size_t word_index) noexcept
+    : words_(words)
+    , word_count_(word_count)
+    , word_index_(word_index)
+    , word_(word_index < word_count ? words[word_index] : 0) {
+    SkipZeroWords();
+}
+
+inline void BitVector::SetBitIterator::SkipZeroWords() noexcept {
+    while (word_ == 0 && word_index_ < word_count_) {
+        if (++word_index_ < word_count_) {
+            word_ = words_[word_index_];
+        }
+    }
+}
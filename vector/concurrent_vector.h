@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "raw_memory.h"
+#include "segment_layout.h"
+
+// ConcurrentVector is an append-only vector that many threads may grow at
+// once. Elements live in segments of doubling size (RawMemory blocks), so
+// they never move. EmplaceBack makes sure the segment of the next slot
+// exists, claims the slot with a compare-and-swap and constructs the element
+// in place. A missing segment is allocated by whichever thread needs it
+// first and published with a compare-and-swap, so a failed allocation
+// throws before any slot is claimed.
+//
+// Size() counts the published prefix: slots that are finished and all of
+// whose predecessors are as well. Readers may index and iterate that prefix
+// while writers keep appending. If constructing an element throws, its slot
+// is finished as a tombstone: it is counted by Size() and later elements are
+// still published, but iteration skips it and it must not be indexed.
+template <typename T, typename Alloc = std::allocator<T>>
+class ConcurrentVector {
+    template <bool IsConst>
+    class Iterator;
+
+public:
+    using allocator_type = typename RawMemory<T, Alloc>::allocator_type;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    ConcurrentVector() = default;
+    explicit ConcurrentVector(const allocator_type& alloc) noexcept;
+
+    ConcurrentVector(const ConcurrentVector&) = delete;
+    ConcurrentVector& operator=(const ConcurrentVector&) = delete;
+
+    // Thread-safe. Returns the new element, which is published once every
+    // element before it is constructed too.
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args);
+
+    template <typename V>
+    T& PushBack(V&& value);
+
+    // Allocates the segments needed to hold `capacity` elements
+    void Reserve(size_t capacity);
+
+    // Number of published slots, tombstones included
+    size_t Size() const noexcept { return published_.load(std::memory_order_acquire); }
+
+    // True if the published slot `index` holds no element because its
+    // constructor threw
+    bool IsTombstone(size_t index) const noexcept;
+
+    // `index` must be below a value returned by Size() and not a tombstone,
+    // or be the index of an element returned by EmplaceBack on this thread
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+
+    // Iterate over the elements published when begin()/end() were called,
+    // skipping tombstones
+    iterator begin() noexcept { return iterator(this, 0, Size()); }
+    iterator end() noexcept { return iterator(this, Size(), Size()); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0, Size()); }
+    const_iterator end() const noexcept { return const_iterator(this, Size(), Size()); }
+
+    ~ConcurrentVector();
+
+private:
+    using Layout = SegmentLayout<T>;
+
+    static constexpr size_t kMaxSegments = Layout::kMaxSegments;
+
+    enum SlotState : uint8_t { kEmpty, kConstructed, kBroken };
+
+    struct Segment {
+        Segment(size_t size, const allocator_type& alloc)
+            : storage(size, alloc), states(std::make_unique<std::atomic<uint8_t>[]>(size)) {}
+
+        RawMemory<T, Alloc> storage;
+        std::unique_ptr<std::atomic<uint8_t>[]> states;
+    };
+
+    Segment& GetOrCreateSegment(size_t segment);
+    std::atomic<uint8_t>* StateOf(size_t index) const noexcept;
+    // Marks the slot and advances the published prefix over every
+    // finished slot that follows it
+    void Publish(size_t index, SlotState state) noexcept;
+
+    allocator_type alloc_;
+    std::atomic<Segment*> segments_[kMaxSegments] = {};
+    std::atomic<size_t> claimed_{0};
+    std::atomic<size_t> published_{0};
+};
+
+template <typename T, typename Alloc>
+template <bool IsConst>
+class ConcurrentVector<T, Alloc>::Iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using Owner = std::conditional_t<IsConst, const ConcurrentVector, ConcurrentVector>;
+
+    Iterator() = default;
+    Iterator(Owner* owner, size_t index, size_t end) noexcept : owner_(owner), index_(index), end_(end) {
+        SkipTombstones();
+    }
+
+    reference operator*() const noexcept { return (*owner_)[index_]; }
+    pointer operator->() const noexcept { return &(*owner_)[index_]; }
+
+    Iterator& operator++() noexcept {
+        ++index_;
+        SkipTombstones();
+        return *this;
+    }
+
+    Iterator operator++(int) noexcept {
+        Iterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    bool operator==(const Iterator& other) const noexcept { return index_ == other.index_; }
+    bool operator!=(const Iterator& other) const noexcept { return index_ != other.index_; }
+
+private:
+    Owner* owner_ = nullptr;
+    size_t index_ = 0;
+    size_t end_ = 0;
+
+    void SkipTombstones() noexcept {
+        while (index_ < end_ && owner_->IsTombstone(index_)) {
+            ++index_;
+        }
+    }
+};
+
+
+// Implementation of ConcurrentVector class template methods
+
+
+template <typename T, typename Alloc>
+ConcurrentVector<T, Alloc>::ConcurrentVector(const allocator_type& alloc) noexcept
+    : alloc_(alloc) {}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+T& ConcurrentVector<T, Alloc>::EmplaceBack(Args&&... args) {
+    // The segment is created before the slot is claimed, so every claimed
+    // slot has a state to be finished with
+    size_t index = claimed_.load(std::memory_order_relaxed);
+    Segment* block = nullptr;
+    do {
+        assert(Layout::SegmentOf(index) < kMaxSegments);
+        block = &GetOrCreateSegment(Layout::SegmentOf(index));
+    } while (!claimed_.compare_exchange_weak(index, index + 1, std::memory_order_relaxed));
+    T* slot = block->storage + (index - Layout::SegmentStart(Layout::SegmentOf(index)));
+    try {
+        new (slot) T(std::forward<Args>(args)...);
+    } catch (...) {
+        Publish(index, kBroken);
+        throw;
+    }
+    Publish(index, kConstructed);
+    return *slot;
+}
+
+template <typename T, typename Alloc>
+template <typename V>
+T& ConcurrentVector<T, Alloc>::PushBack(V&& value) {
+    return EmplaceBack(std::forward<V>(value));
+}
+
+template <typename T, typename Alloc>
+void ConcurrentVector<T, Alloc>::Reserve(size_t capacity) {
+    for (size_t segment = 0; segment < kMaxSegments && Layout::SegmentStart(segment) < capacity; ++segment) {
+        GetOrCreateSegment(segment);
+    }
+}
+
+template <typename T, typename Alloc>
+bool ConcurrentVector<T, Alloc>::IsTombstone(size_t index) const noexcept {
+    return StateOf(index)->load(std::memory_order_acquire) == kBroken;
+}
+
+template <typename T, typename Alloc>
+const T& ConcurrentVector<T, Alloc>::operator[](size_t index) const noexcept {
+    return const_cast<ConcurrentVector&>(*this)[index];
+}
+
+template <typename T, typename Alloc>
+T& ConcurrentVector<T, Alloc>::operator[](size_t index) noexcept {
+    const size_t segment = Layout::SegmentOf(index);
+    Segment* block = segments_[segment].load(std::memory_order_acquire);
+    assert(block != nullptr && block->states[index - Layout::SegmentStart(segment)].load() != kBroken);
+    return block->storage[index - Layout::SegmentStart(segment)];
+}
+
+template <typename T, typename Alloc>
+ConcurrentVector<T, Alloc>::~ConcurrentVector() {
+    const size_t claimed = claimed_.load(std::memory_order_acquire);
+    for (size_t segment = 0; segment < kMaxSegments; ++segment) {
+        Segment* block = segments_[segment].load(std::memory_order_acquire);
+        if (block == nullptr) {
+            continue;
+        }
+        const size_t start = Layout::SegmentStart(segment);
+        const size_t count = claimed > start ? std::min(claimed - start, Layout::SegmentSize(segment)) : 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (block->states[i].load(std::memory_order_relaxed) == kConstructed) {
+                std::destroy_at(block->storage + i);
+            }
+        }
+        delete block;
+    }
+}
+
+template <typename T, typename Alloc>
+typename ConcurrentVector<T, Alloc>::Segment& ConcurrentVector<T, Alloc>::GetOrCreateSegment(size_t segment) {
+    Segment* block = segments_[segment].load(std::memory_order_acquire);
+    if (block != nullptr) {
+        return *block;
+    }
+    auto fresh = std::make_unique<Segment>(Layout::SegmentSize(segment), alloc_);
+    if (segments_[segment].compare_exchange_strong(block, fresh.get(), std::memory_order_acq_rel)) {
+        return *fresh.release();
+    }
+    // Another thread published the segment first; ours is freed
+    return *block;
+}
+
+template <typename T, typename Alloc>
+std::atomic<uint8_t>* ConcurrentVector<T, Alloc>::StateOf(size_t index) const noexcept {
+    const size_t segment = Layout::SegmentOf(index);
+    if (segment >= kMaxSegments) {
+        return nullptr;
+    }
+    Segment* block = segments_[segment].load(std::memory_order_acquire);
+    return block == nullptr ? nullptr : &block->states[index - Layout::SegmentStart(segment)];
+}
+
+template <typename T, typename Alloc>
+void ConcurrentVector<T, Alloc>::Publish(size_t index, SlotState state) noexcept {
+    StateOf(index)->store(state);
+    // Sequentially consistent operations make sure that of two writers
+    // finishing neighbouring slots at once, at least one sees the other's
+    // slot and moves the prefix past both
+    size_t published = published_.load();
+    while (true) {
+        std::atomic<uint8_t>* next = StateOf(published);
+        if (next == nullptr || next->load() == kEmpty) {
+            return;
+        }
+        if (published_.compare_exchange_weak(published, published + 1)) {
+            ++published;
+        }
+    }
+}
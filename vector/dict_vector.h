@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "bit_vector.h"
+#include "vector.h"
+
+// DictVector stores a column of repetitive values with dictionary encoding.
+// Each distinct value is kept once in the dictionary, and every element is
+// a code indexing it. Codes are 8 bits wide while the dictionary has at most
+// 256 entries. They widen to 16 and then 32 bits as it grows, re-encoding
+// the codes once per step.
+//
+// Element access decodes through the dictionary. Equal/NotEqual look the
+// value up once and then compare codes, producing a BitVector.
+// Dictionary entries are never removed, even when Set overwrites the last
+// element using them.
+template <typename T, typename Hash = std::hash<T>>
+class DictVector {
+public:
+    // Returned by Find for values not in the dictionary
+    static constexpr size_t kNoCode = static_cast<size_t>(-1);
+
+    DictVector() = default;
+    template <typename A, typename G>
+    explicit DictVector(const Vector<T, A, G>& values);
+
+    void Reserve(size_t new_capacity);
+
+    void PushBack(const T& value);
+    void Set(size_t index, const T& value);
+
+    const T& operator[](size_t index) const noexcept { return dictionary_[Code(index)]; }
+    size_t Code(size_t index) const noexcept;
+
+    // Code of `value`, or kNoCode
+    size_t Find(const T& value) const;
+
+    // Bit i is set if element i equals (does not equal) `value`
+    BitVector Equal(const T& value) const;
+    BitVector NotEqual(const T& value) const;
+
+    // Replaces the contents of `out` with all elements
+    template <typename A, typename G>
+    void Decode(Vector<T, A, G>& out) const;
+
+    size_t Size() const noexcept;
+    // Width of a code: 1, 2 or 4 bytes
+    size_t CodeBytes() const noexcept;
+    const Vector<T>& Dictionary() const noexcept { return dictionary_; }
+
+private:
+    static constexpr uint32_t kEmptySlot = static_cast<uint32_t>(-1);
+
+    Vector<T> dictionary_;
+    // Open-addressing table of dictionary codes, probed linearly, so the
+    // values themselves are not stored twice
+    Vector<uint32_t> slots_;
+    // Only the vector of the current code width is in use
+    Vector<uint8_t> codes8_;
+    Vector<uint16_t> codes16_;
+    Vector<uint32_t> codes32_;
+
+    // Calls `fn(codes)` with the vector of the current code width
+    template <typename Fn>
+    decltype(auto) VisitCodes(Fn&& fn) const;
+    template <typename Fn>
+    decltype(auto) VisitCodes(Fn&& fn);
+
+    // Slot holding `value` or the empty slot where it would go
+    size_t Probe(const T& value) const;
+
+    // Code of `value`, adding it to the dictionary if needed
+    uint32_t Intern(const T& value);
+
+    void Rehash(size_t slot_count);
+
+    // Moves the codes to a vector twice as wide
+    template <typename From, typename To>
+    static void Widen(Vector<From>& from, Vector<To>& to);
+};
+
+
+// Implementation of DictVector class template methods
+
+
+template <typename T, typename Hash>
+template <typename A, typename G>
+DictVector<T, Hash>::DictVector(const Vector<T, A, G>& values) {
+    Reserve(values.Size());
+    for (const T& value : values) {
+        PushBack(value);
+    }
+}
+
+template <typename T, typename Hash>
+void DictVector<T, Hash>::Reserve(size_t new_capacity) {
+    VisitCodes([new_capacity](auto& codes) { codes.Reserve(new_capacity); });
+}
+
+template <typename T, typename Hash>
+void DictVector<T, Hash>::PushBack(const T& value) {
+    const uint32_t code = Intern(value);
+    VisitCodes([code](auto& codes) {
+        using Code = std::remove_reference_t<decltype(codes[0])>;
+        codes.PushBack(static_cast<Code>(code));
+    });
+}
+
+template <typename T, typename Hash>
+void DictVector<T, Hash>::Set(size_t index, const T& value) {
+    assert(index < Size());
+    const uint32_t code = Intern(value);
+    VisitCodes([index, code](auto& codes) {
+        using Code = std::remove_reference_t<decltype(codes[0])>;
+        codes[index] = static_cast<Code>(code);
+    });
+}
+
+template <typename T, typename Hash>
+size_t DictVector<T, Hash>::Code(size_t index) const noexcept {
+    assert(index < Size());
+    return VisitCodes([index](const auto& codes) -> size_t { return codes[index]; });
+}
+
+template <typename T, typename Hash>
+size_t DictVector<T, Hash>::Find(const T& value) const {
+    if (slots_.Size() == 0) {
+        return kNoCode;
+    }
+    const uint32_t code = slots_[Probe(value)];
+    return code == kEmptySlot ? kNoCode : code;
+}
+
+template <typename T, typename Hash>
+BitVector DictVector<T, Hash>::Equal(const T& value) const {
+    const size_t size = Size();
+    BitVector result(size);
+    const size_t code = Find(value);
+    if (code == kNoCode) {
+        return result;
+    }
+    uint64_t* words = result.Words();
+    VisitCodes([&](const auto& codes) {
+        using Code = std::remove_const_t<std::remove_reference_t<decltype(codes[0])>>;
+        const Code needle = static_cast<Code>(code);
+        const Code* data = codes.begin();
+        // Branch-free compares over a word's worth of codes, which the
+        // compiler can vectorize
+        for (size_t first = 0; first < size; first += BitVector::kWordBits) {
+            const size_t count = std::min(BitVector::kWordBits, size - first);
+            uint64_t word = 0;
+            for (size_t i = 0; i < count; ++i) {
+                word |= uint64_t(data[first + i] == needle) << i;
+            }
+            words[first / BitVector::kWordBits] = word;
+        }
+    });
+    return result;
+}
+
+template <typename T, typename Hash>
+BitVector DictVector<T, Hash>::NotEqual(const T& value) const {
+    BitVector result = Equal(value);
+    result.Flip();
+    return result;
+}
+
+template <typename T, typename Hash>
+template <typename A, typename G>
+void DictVector<T, Hash>::Decode(Vector<T, A, G>& out) const {
+    out.Resize(0);
+    out.Reserve(Size());
+    VisitCodes([&](const auto& codes) {
+        for (auto code : codes) {
+            out.PushBack(dictionary_[code]);
+        }
+    });
+}
+
+template <typename T, typename Hash>
+size_t DictVector<T, Hash>::Size() const noexcept {
+    return VisitCodes([](const auto& codes) { return codes.Size(); });
+}
+
+template <typename T, typename Hash>
+size_t DictVector<T, Hash>::CodeBytes() const noexcept {
+    return VisitCodes([](const auto& codes) { return sizeof(codes[0]); });
+}
+
+template <typename T, typename Hash>
+template <typename Fn>
+decltype(auto) DictVector<T, Hash>::VisitCodes(Fn&& fn) const {
+    if (dictionary_.Size() <= (size_t{1} << 8)) {
+        return fn(codes8_);
+    }
+    if (dictionary_.Size() <= (size_t{1} << 16)) {
+        return fn(codes16_);
+    }
+    return fn(codes32_);
+}
+
+template <typename T, typename Hash>
+template <typename Fn>
+decltype(auto) DictVector<T, Hash>::VisitCodes(Fn&& fn) {
+    if (dictionary_.Size() <= (size_t{1} << 8)) {
+        return fn(codes8_);
+    }
+    if (dictionary_.Size() <= (size_t{1} << 16)) {
+        return fn(codes16_);
+    }
+    return fn(codes32_);
+}
+
+template <typename T, typename Hash>
+size_t DictVector<T, Hash>::Probe(const T& value) const {
+    const size_t mask = slots_.Size() - 1;
+    for (size_t slot = Hash()(value) & mask;; slot = (slot + 1) & mask) {
+        const uint32_t code = slots_[slot];
+        if (code == kEmptySlot || dictionary_[code] == value) {
+            return slot;
+        }
+    }
+}
+
+template <typename T, typename Hash>
+uint32_t DictVector<T, Hash>::Intern(const T& value) {
+    if (slots_.Size() == 0) {
+        Rehash(16);
+    }
+    size_t slot = Probe(value);
+    if (slots_[slot] != kEmptySlot) {
+        return slots_[slot];
+    }
+    const size_t code = dictionary_.Size();
+    assert(code < kEmptySlot);
+    // The table is kept at most half full
+    if (2 * (code + 1) > slots_.Size()) {
+        Rehash(2 * slots_.Size());
+        slot = Probe(value);
+    }
+    dictionary_.PushBack(value);
+    // Codes widen when the dictionary outgrows them
+    try {
+        if (code == (size_t{1} << 8)) {
+            Widen(codes8_, codes16_);
+        } else if (code == (size_t{1} << 16)) {
+            Widen(codes16_, codes32_);
+        }
+    } catch (...) {
+        dictionary_.PopBack();
+        throw;
+    }
+    slots_[slot] = static_cast<uint32_t>(code);
+    return static_cast<uint32_t>(code);
+}
+
+template <typename T, typename Hash>
+void DictVector<T, Hash>::Rehash(size_t slot_count) {
+    Vector<uint32_t> slots(slot_count);
+    std::fill(slots.begin(), slots.end(), kEmptySlot);
+    slots_.Swap(slots);
+    for (size_t code = 0; code < dictionary_.Size(); ++code) {
+        slots_[Probe(dictionary_[code])] = static_cast<uint32_t>(code);
+    }
+}
+
+template <typename T, typename Hash>
+template <typename From, typename To>
+void DictVector<T, Hash>::Widen(Vector<From>& from, Vector<To>& to) {
+    to.Reserve(std::max(from.Capacity(), from.Size() + 1));
+    for (From code : from) {
+        to.PushBack(code);
+    }
+    Vector<From>().Swap(from);
+}
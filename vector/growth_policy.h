@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+// Growth policies decide how much capacity `Vector` allocates. A policy
+// provides two static functions, both returning at least `required`:
+//
+//     // Capacity to grow to when `required` elements do not fit in `capacity`
+//     template <typename T> static size_t Grow(size_t capacity, size_t required) noexcept;
+//     // Capacity to allocate when exactly `required` elements are requested
+//     template <typename T> static size_t Fit(size_t required) noexcept;
+//
+// `Grow` drives EmplaceBack/Insert and growing Resize; `Fit` drives Reserve.
+// Policies compose: MinFirstCapacity and CappedGrowth wrap a base policy.
+//
+// A policy may also release memory when elements are removed by providing
+//
+//     // Capacity to shrink to once `size` elements remain, or `capacity` to keep the buffer
+//     template <typename T> static size_t Shrink(size_t capacity, size_t size) noexcept;
+//
+// which Vector consults after PopBack, Erase, EraseIf and shrinking Resize.
+// See HysteresisShrink.
+
+// Multiplies the capacity by Num / Den on each reallocation
+template <size_t Num, size_t Den>
+struct GeometricGrowth {
+    static_assert(Num > Den && Den > 0, "Growth factor must be greater than one");
+
+    template <typename T>
+    static constexpr size_t Grow(size_t capacity, size_t required) noexcept {
+        return std::max(required, capacity / Den * Num + capacity % Den * Num / Den);
+    }
+
+    template <typename T>
+    static constexpr size_t Fit(size_t required) noexcept {
+        return required;
+    }
+};
+
+using DoublingGrowth = GeometricGrowth<2, 1>;
+using GoldenGrowth = GeometricGrowth<3, 2>;
+
+// Makes the first allocation hold at least `MinBytes` worth of elements,
+// skipping the 1, 2, 4, 8... reallocations of small vectors
+template <typename Base, size_t MinBytes = 64>
+struct MinFirstCapacity {
+    template <typename T>
+    static constexpr size_t MinCapacity() noexcept {
+        return std::max<size_t>(1, MinBytes / sizeof(T));
+    }
+
+    template <typename T>
+    static constexpr size_t Grow(size_t capacity, size_t required) noexcept {
+        const size_t grown = Base::template Grow<T>(capacity, required);
+        return capacity == 0 ? std::max(grown, MinCapacity<T>()) : grown;
+    }
+
+    template <typename T>
+    static constexpr size_t Fit(size_t required) noexcept {
+        return std::max(Base::template Fit<T>(required), MinCapacity<T>());
+    }
+};
+
+// Limits each growth step to `MaxStepBytes` worth of elements, so huge
+// vectors grow additively instead of leaving up to (factor - 1) slack
+template <typename Base, size_t MaxStepBytes = size_t{64} << 20>
+struct CappedGrowth {
+    template <typename T>
+    static constexpr size_t Grow(size_t capacity, size_t required) noexcept {
+        const size_t max_step = std::max<size_t>(1, MaxStepBytes / sizeof(T));
+        const size_t capped = std::max(required, capacity + max_step);
+        return std::min(Base::template Grow<T>(capacity, required), capped);
+    }
+
+    template <typename T>
+    static constexpr size_t Fit(size_t required) noexcept {
+        return Base::template Fit<T>(required);
+    }
+};
+
+// Shrinks the buffer once the size drops below Num / Den of the capacity.
+// The new capacity is what `Base` would grow the remaining elements to, so
+// that a vector oscillating around a size neither reallocates on every
+// push nor on every pop: with doubling growth and the default 1/4 threshold
+// a shrunk vector is half full. Buffers of at most `MinBytes` are kept.
+template <typename Base, size_t Num = 1, size_t Den = 4, size_t MinBytes = 4096>
+struct HysteresisShrink {
+    static_assert(Num < Den, "Shrink threshold must be below one");
+
+    template <typename T>
+    static constexpr size_t Grow(size_t capacity, size_t required) noexcept {
+        return Base::template Grow<T>(capacity, required);
+    }
+
+    template <typename T>
+    static constexpr size_t Fit(size_t required) noexcept {
+        return Base::template Fit<T>(required);
+    }
+
+    template <typename T>
+    static constexpr size_t Shrink(size_t capacity, size_t size) noexcept {
+        const size_t threshold = capacity / Den * Num + capacity % Den * Num / Den;
+        if (capacity <= MinBytes / sizeof(T) || size >= threshold) {
+            return capacity;
+        }
+        const size_t grown = size == 0 ? 0 : Base::template Grow<T>(size, size + 1);
+        const size_t target = std::max(grown, MinBytes / sizeof(T));
+        return std::min(target, capacity);
+    }
+};
+
+template <typename Policy, typename T, typename = void>
+struct HasShrinkPolicy : std::false_type {};
+
+template <typename Policy, typename T>
+struct HasShrinkPolicy<Policy, T, std::void_t<decltype(Policy::template Shrink<T>(size_t{}, size_t{}))>>
+    : std::true_type {};
+
+using DefaultGrowth = DoublingGrowth;
@@ -1,10 +1,38 @@
 #include "vector.h"
+#include "aligned_allocator.h"
+#include "arena.h"
+#include "bit_vector.h"
+#include "concurrent_vector.h"
+#include "dict_vector.h"
+#include "malloc_allocator.h"
+#include "mapped_file_allocator.h"
+#include "packed_int_vector.h"
+#include "parallel.h"
+#include "pool_allocator.h"
+#include "rank_select.h"
+#include "serialization.h"
+#include "simd_kernels.h"
+#include "small_vector.h"
+#include "soa_vector.h"
+#include "sorted_delta_vector.h"
+#include "stable_vector.h"
+#include "virtual_memory_allocator.h"
 
+#include <chrono>
+#include <cmath>
+#include <fstream>
 #include <iostream>
+#include <list>
+#include <memory_resource>
+#include <numeric>
+#include <random>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
+#include <sys/resource.h>
+
 namespace {
 
 inline const uint32_t DEFAULT_COOKIE = 0xdeadbeef;
@@ -553,85 +581,2032 @@ void Test6() {
     }
 }
 
-struct C {
-    C() noexcept {
-        ++def_ctor;
+// Stateful allocator that counts live allocations per arena id.
+// Allocators with different ids compare unequal.
+template <typename T, bool Propagate>
+struct TrackingAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_move_assignment = std::bool_constant<Propagate>;
+    using propagate_on_container_swap = std::bool_constant<Propagate>;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackingAllocator<U, Propagate>;
+    };
+
+    explicit TrackingAllocator(int id = 0) noexcept
+        : id(id) {
     }
-    C(const C& /*other*/) noexcept {
-        ++copy_ctor;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Propagate>& other) noexcept
+        : id(other.id) {
     }
-    C(C&& /*other*/) noexcept {
-        ++move_ctor;
+
+    T* allocate(size_t n) {
+        ++live_allocations[id];
+        return static_cast<T*>(operator new(n * sizeof(T)));
     }
-    C& operator=(const C& other) noexcept {
-        if (this != &other) {
-            ++copy_assign;
-        }
-        return *this;
+
+    void deallocate(T* p, size_t /*n*/) noexcept {
+        --live_allocations[id];
+        operator delete(p);
     }
-    C& operator=(C&& /*other*/) noexcept {
-        ++move_assign;
-        return *this;
+
+    TrackingAllocator select_on_container_copy_construction() const {
+        return TrackingAllocator(id + 100);
     }
-    ~C() {
-        ++dtor;
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U, Propagate>& other) const noexcept {
+        return id == other.id;
     }
 
-    static void Reset() {
-        def_ctor = 0;
-        copy_ctor = 0;
-        move_ctor = 0;
-        copy_assign = 0;
-        move_assign = 0;
-        dtor = 0;
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U, Propagate>& other) const noexcept {
+        return id != other.id;
     }
 
-    inline static size_t def_ctor = 0;
-    inline static size_t copy_ctor = 0;
-    inline static size_t move_ctor = 0;
-    inline static size_t copy_assign = 0;
-    inline static size_t move_assign = 0;
-    inline static size_t dtor = 0;
+    int id;
+    static inline int live_allocations[256] = {};
 };
 
-void Dump() {
-    using namespace std;
-    cerr << "Def ctors: "sv << C::def_ctor              //
-         << ", Copy ctors: "sv << C::copy_ctor          //
-         << ", Move ctors: "sv << C::move_ctor          //
-         << ", Copy assignments: "sv << C::copy_assign  //
-         << ", Move assignments: "sv << C::move_assign  //
-         << ", Dtors: "sv << C::dtor << endl;
+void Test7() {
+    const size_t SIZE = 20;
+    using StickyAlloc = TrackingAllocator<Obj, false>;
+    using PropagatingAlloc = TrackingAllocator<Obj, true>;
+    {
+        Obj::ResetCounters();
+        Vector<Obj, StickyAlloc> v(SIZE, StickyAlloc(1));
+        v.PushBack(Obj{1});
+        assert(StickyAlloc::live_allocations[1] == 1);
+
+        Vector<Obj, StickyAlloc> v_copy(v);
+        assert(v_copy.GetAllocator().id == 101);
+        assert(StickyAlloc::live_allocations[101] == 1);
+
+        // Unequal allocators that do not propagate: elements are moved
+        // into the target's own buffer instead of stealing rhs's buffer.
+        Vector<Obj, StickyAlloc> other(StickyAlloc(2));
+        const int old_num_moved = Obj::num_moved;
+        other = std::move(v);
+        assert(other.GetAllocator().id == 2);
+        assert(other.Size() == SIZE + 1);
+        assert(Obj::num_moved == old_num_moved + static_cast<int>(SIZE + 1));
+        assert(StickyAlloc::live_allocations[2] == 1);
+
+        other = v_copy;
+        assert(other.GetAllocator().id == 2);
+        assert(other.Size() == SIZE + 1);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    assert(StickyAlloc::live_allocations[1] == 0);
+    assert(StickyAlloc::live_allocations[2] == 0);
+    assert(StickyAlloc::live_allocations[101] == 0);
+    {
+        Obj::ResetCounters();
+        Vector<Obj, PropagatingAlloc> v(SIZE, PropagatingAlloc(3));
+        Vector<Obj, PropagatingAlloc> other(PropagatingAlloc(4));
+        other = std::move(v);
+        assert(other.GetAllocator().id == 3);
+        assert(Obj::num_moved == 0);
+
+        Vector<Obj, PropagatingAlloc> copy_target(1, PropagatingAlloc(5));
+        copy_target = other;
+        assert(copy_target.GetAllocator().id == 3);
+        assert(PropagatingAlloc::live_allocations[5] == 0);
+
+        Vector<Obj, PropagatingAlloc> swap_target(2, PropagatingAlloc(6));
+        swap_target.Swap(other);
+        assert(swap_target.GetAllocator().id == 3);
+        assert(swap_target.Size() == SIZE);
+        assert(other.GetAllocator().id == 6);
+        assert(other.Size() == 2);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    assert(PropagatingAlloc::live_allocations[3] == 0);
+    assert(PropagatingAlloc::live_allocations[6] == 0);
+    {
+        // polymorphic_allocator neither propagates nor assigns
+        using PmrVector = Vector<int, std::pmr::polymorphic_allocator<int>>;
+        std::pmr::monotonic_buffer_resource first_resource;
+        std::pmr::monotonic_buffer_resource second_resource;
+        PmrVector v(&first_resource);
+        for (int i = 0; i < static_cast<int>(SIZE); ++i) {
+            v.PushBack(i);
+        }
+        v.Insert(v.cbegin(), 3, -1);
+        v.ShrinkToFit();
+        assert(v.Size() == SIZE + 3 && v[0] == -1 && v[SIZE + 2] == static_cast<int>(SIZE - 1));
+
+        PmrVector other(&second_resource);
+        other = v;
+        assert(other.GetAllocator().resource() == &second_resource);
+        const int* v_data = v.begin();
+        other = std::move(v);
+        assert(other.GetAllocator().resource() == &second_resource);
+        assert(other.begin() != v_data && other.Size() == SIZE + 3);
+
+        PmrVector same(2, &second_resource);
+        const int* other_data = other.begin();
+        same.Swap(other);
+        assert(same.begin() == other_data && same.Size() == SIZE + 3);
+        assert(other.Size() == 2);
+        other = std::move(same);
+        assert(other.begin() == other_data && same.Size() == 0);
+    }
 }
 
-void Benchmark() {
-    using namespace std;
-    try {
-        const size_t NUM = 10;
-        C c;
-        {
-            cerr << "std::vector:"sv << endl;
-            C::Reset();
-            vector<C> v(NUM);
-            Dump();
-            v.push_back(c);
+void Test8() {
+    const size_t SIZE = 1000;
+    {
+        MonotonicArena arena(SIZE * sizeof(int) * 4);
+        Vector<int, ArenaAllocator<int>> v{ArenaAllocator<int>(arena)};
+        v.PushBack(0);
+        const int* first = &v[0];
+        for (size_t i = 1; i < SIZE; ++i) {
+            v.PushBack(static_cast<int>(i));
         }
-        Dump();
-    } catch (...) {
+        // The vector is the only user of the arena, so every growth step
+        // extended the latest allocation in place.
+        assert(&v[0] == first);
+        assert(arena.BlockCount() == 1);
+        assert(v[SIZE - 1] == static_cast<int>(SIZE - 1));
+
+        Vector<int, ArenaAllocator<int>> other{ArenaAllocator<int>(arena)};
+        other.PushBack(1);
+        v.Reserve(v.Capacity() * 4);
+        assert(&v[0] != first);
+        assert(v[SIZE - 1] == static_cast<int>(SIZE - 1));
     }
-    try {
-        const size_t NUM = 10;
-        C c;
+    {
+        Obj::ResetCounters();
+        MonotonicArena arena(64);
         {
-            cerr << "Vector:"sv << endl;
-            C::Reset();
-            Vector<C> v(NUM);
-            Dump();
-            v.PushBack(c);
+            Vector<Obj, ArenaAllocator<Obj>> v{ArenaAllocator<Obj>(arena)};
+            for (int i = 0; i < 100; ++i) {
+                v.EmplaceBack(i);
+            }
+            v.Insert(v.cbegin() + 10, Obj{-1});
+            assert(v[10].id == -1);
+            assert(v[11].id == 10);
+            assert(arena.BytesAllocated() >= v.Capacity() * sizeof(Obj));
         }
-        Dump();
-    } catch (...) {
+        assert(Obj::GetAliveObjectCount() == 0);
+        const size_t blocks = arena.BlockCount();
+        assert(blocks > 1);
+        arena.Reset();
+        assert(arena.BlockCount() == 1);
+        assert(arena.BytesAllocated() == 0);
+    }
+}
+
+void Test9() {
+    {
+        BufferPool& pool = BufferPool::Local();
+        pool.Trim();
+        const auto before = pool.GetStats();
+        for (int round = 0; round < 10; ++round) {
+            Vector<int, PoolAllocator<int>> v;
+            for (int i = 0; i < 1000; ++i) {
+                v.PushBack(i);
+            }
+            assert(v[999] == 999);
+        }
+        const auto after = pool.GetStats();
+        // After the first round every growth step reuses a cached buffer
+        assert(after.hits - before.hits >= 9 * 9);
+        assert(after.cached_bytes > 0);
+        pool.Trim();
+        assert(pool.GetStats().cached_bytes == 0);
+    }
+    {
+        BufferPool global(BufferPoolLimits{1024, 1024}, nullptr, true);
+        BufferPool local(BufferPoolLimits{256, 128}, &global);
+        void* small = local.Allocate(100);
+        void* large = local.Allocate(1000);
+        local.Deallocate(small, 100);
+        local.Deallocate(large, 1000);
+        // Too large for the local pool: it overflowed into the global one
+        assert(local.GetStats().cached_bytes == 128);
+        assert(global.GetStats().cached_bytes == 1024);
+        assert(local.Allocate(1000) == large);
+        assert(local.Allocate(120) == small);
+        local.Deallocate(large, 1000);
+        local.Deallocate(small, 120);
+        local.SetLimits(BufferPoolLimits{0, 0});
+        assert(local.GetStats().cached_bytes == 0);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj, PoolAllocator<Obj>> v(10);
+        v.Insert(v.cbegin() + 5, Obj{1});
+        assert(v[5].id == 1);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test10() {
+    const size_t N = 4;
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, N> v;
+        assert(v.Capacity() == N);
+        for (size_t i = 0; i < N; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        assert(v.IsInline());
+        assert(reinterpret_cast<const std::byte*>(&v[0]) >= reinterpret_cast<const std::byte*>(&v));
+        assert(reinterpret_cast<const std::byte*>(&v[N - 1]) < reinterpret_cast<const std::byte*>(&v + 1));
+
+        v.Insert(v.cbegin() + 1, Obj{42});
+        assert(!v.IsInline());
+        assert(v.Size() == N + 1);
+        assert(v.Capacity() == N * 2);
+        assert(v[1].id == 42);
+        assert(v[2].id == 1);
+
+        auto* pos = v.Erase(v.cbegin() + 1);
+        assert(pos->id == 1);
+        assert(v.Size() == N);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(N));
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, N> v(N);
+        v[N - 1].throw_on_copy = true;
+        // Obj is nothrow-movable, so spilling moves and never throws
+        v.PushBack(Obj{1});
+        assert(Obj::num_copied == 0);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(N + 1));
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        struct ThrowingCopy {
+            ThrowingCopy() = default;
+            ThrowingCopy(const ThrowingCopy& other) {
+                if (other.throw_on_copy) {
+                    throw std::runtime_error("Oops");
+                }
+            }
+            ThrowingCopy& operator=(const ThrowingCopy& other) = default;
+            bool throw_on_copy = false;
+        };
+        SmallVector<ThrowingCopy, N> v(N);
+        v[1].throw_on_copy = true;
+        try {
+            v.PushBack(ThrowingCopy{});
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        // Strong guarantee: the inline elements were left untouched
+        assert(v.IsInline());
+        assert(v.Size() == N);
+        assert(v[1].throw_on_copy);
+    }
+    {
+        Obj::ResetCounters();
+        SmallVector<Obj, N> small(2);
+        SmallVector<Obj, N> large(N * 3);
+        small[0].id = 1;
+        large[0].id = 2;
+
+        SmallVector<Obj, N> small_copy(small);
+        SmallVector<Obj, N> large_copy(large);
+        assert(small_copy.IsInline() && small_copy[0].id == 1);
+        assert(!large_copy.IsInline() && large_copy[0].id == 2);
+
+        small_copy = large;
+        assert(small_copy.Size() == N * 3);
+        large_copy = small;
+        assert(large_copy.Size() == 2);
+
+        const Obj* large_data = &large[0];
+        SmallVector<Obj, N> moved_large(std::move(large));
+        assert(&moved_large[0] == large_data);
+        assert(large.Size() == 0);
+
+        SmallVector<Obj, N> moved_small(std::move(small));
+        assert(moved_small.IsInline() && moved_small[0].id == 1);
+
+        moved_small.Swap(moved_large);
+        assert(moved_small.Size() == N * 3 && moved_small[0].id == 2);
+        assert(moved_large.Size() == 2 && moved_large[0].id == 1);
+        assert(moved_large.IsInline());
+
+        moved_large.Resize(N * 2);
+        assert(!moved_large.IsInline());
+        moved_large.Resize(1);
+        assert(moved_large.Size() == 1 && moved_large[0].id == 1);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+// Owns a resource through unique_ptr and counts its moves; opted in as
+// trivially relocatable below.
+struct Relocatable {
+    explicit Relocatable(int value)
+        : value(std::make_unique<int>(value)) {
+    }
+    Relocatable(Relocatable&& other) noexcept
+        : value(std::move(other.value)) {
+        ++num_moved;
+    }
+    Relocatable& operator=(Relocatable&& other) noexcept {
+        value = std::move(other.value);
+        ++num_moved;
+        return *this;
+    }
+    std::unique_ptr<int> value;
+    static inline int num_moved = 0;
+};
+
+template <>
+struct IsTriviallyRelocatable<Relocatable> : std::true_type {};
+
+void Test11() {
+    static_assert(kIsTriviallyRelocatable<int>);
+    static_assert(kIsTriviallyRelocatable<std::unique_ptr<Obj>>);
+    static_assert(!kIsTriviallyRelocatable<Obj>);
+    const int SIZE = 100;
+    {
+        Vector<Relocatable> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        v.Reserve(SIZE * 4);
+        v.Emplace(v.cbegin() + 10, -1);
+        v.Emplace(v.cbegin(), -2);
+        v.Erase(v.cbegin() + 50);
+        assert(Relocatable::num_moved == 0);
+        assert(v.Size() == SIZE + 1);
+        assert(*v[0].value == -2);
+        assert(*v[11].value == -1);
+        assert(*v[12].value == 10);
+        assert(*v[50].value == 49);
+        assert(*v[SIZE].value == SIZE - 1);
+    }
+    {
+        Vector<std::unique_ptr<int>> v;
+        v.PushBack(std::make_unique<int>(1));
+        v.PushBack(std::make_unique<int>(3));
+        v.Insert(v.cbegin() + 1, std::make_unique<int>(2));
+        v.PushBack(std::move(v[0]));
+        assert(v[0] == nullptr);
+        assert(*v[1] == 2 && *v[2] == 3 && *v[3] == 1);
+    }
+    {
+        Vector<int> v(SIZE);
+        for (int i = 0; i < SIZE; ++i) {
+            v[i] = i;
+        }
+        v.Insert(v.cbegin() + 1, v[SIZE - 1]);
+        v.Insert(v.cbegin(), v[0]);
+        assert(v[0] == 0 && v[1] == 0 && v[2] == SIZE - 1 && v[3] == 1);
+        v.Erase(v.cbegin());
+        assert(v[0] == 0 && v[1] == SIZE - 1 && v.Size() == SIZE + 1);
+    }
+    {
+        SmallVector<Relocatable, 2> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        v.Emplace(v.cbegin() + 1, -1);
+        v.Erase(v.cbegin());
+        assert(Relocatable::num_moved == 0);
+        assert(*v[0].value == -1 && *v[1].value == 1);
+    }
+}
+
+void Test12() {
+    {
+        // Grows through realloc and then through mremap past the threshold
+        const size_t SIZE = 3 * MallocAllocator<int>::kMapThreshold / sizeof(int);
+        Vector<int, MallocAllocator<int>> v;
+        for (size_t i = 0; i < SIZE; ++i) {
+            v.PushBack(static_cast<int>(i));
+        }
+        v.Reserve(SIZE * 3);
+        assert(v.Size() == SIZE);
+        for (size_t i = 0; i < SIZE; i += 4099) {
+            assert(v[i] == static_cast<int>(i));
+        }
+        assert(v[SIZE - 1] == static_cast<int>(SIZE - 1));
+    }
+    {
+        Vector<Relocatable, MallocAllocator<Relocatable>> v;
+        v.EmplaceBack(1);
+        // The argument refers into the buffer that is being reallocated
+        v.PushBack(std::move(v[0]));
+        v.Insert(v.cbegin(), Relocatable{0});
+        v.EmplaceBack(3);
+        assert(v.Size() == 4 && v.Capacity() == 4);
+        v.Emplace(v.cbegin() + 2, 2);
+        assert(v[1].value == nullptr);
+        assert(*v[0].value == 0 && *v[2].value == 2 && *v[3].value == 1 && *v[4].value == 3);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj, MallocAllocator<Obj>> v(10);
+        v.PushBack(Obj{1});
+        assert(Obj::num_moved == 11);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+// Private writable memory of the process (VmData), as limited by RLIMIT_DATA
+size_t DataBytes() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    while (status >> key) {
+        if (key == "VmData:") {
+            size_t kilobytes = 0;
+            status >> kilobytes;
+            return kilobytes * 1024;
+        }
+    }
+    return 0;
+}
+
+void Test13() {
+    const VirtualMemoryOptions options{size_t{1} << 20, size_t{1} << 16};
+    {
+        Obj::ResetCounters();
+        VirtualMemoryAllocator<Obj> alloc(options);
+        const size_t max_size = alloc.MaxCapacity();
+        ReservedVector<Obj> v(alloc);
+        v.EmplaceBack(0);
+        const Obj* first = &v[0];
+        for (size_t i = 1; i < max_size; ++i) {
+            v.EmplaceBack(static_cast<int>(i));
+        }
+        assert(&v[0] == first);
+        assert(Obj::num_moved == 0);
+        assert(v[max_size - 1].id == static_cast<int>(max_size - 1));
+        try {
+            v.EmplaceBack(-1);
+            assert(false && "Exception is expected");
+        } catch (const std::bad_alloc&) {
+        }
+        assert(v.Size() == max_size);
+        assert(&v[0] == first);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        ReservedVector<int> v(10, VirtualMemoryAllocator<int>(options));
+        const int* first = &v[0];
+        v.Reserve(1000);
+        v.Resize(5000);
+        v[4999] = 1;
+        assert(&v[0] == first);
+        ReservedVector<int> copy(v);
+        assert(copy.Size() == 5000 && copy[4999] == 1);
+    }
+    {
+        // Committing pages beyond RLIMIT_DATA fails, and growth throws
+        // rather than moving the elements to a new reservation
+        ReservedVector<char> v(VirtualMemoryAllocator<char>({size_t{1} << 34, size_t{1} << 16}));
+        v.Resize(100);
+        const char* first = &v[0];
+        rlimit old_limit;
+        getrlimit(RLIMIT_DATA, &old_limit);
+        rlimit limit = old_limit;
+        limit.rlim_cur = std::min<rlim_t>(old_limit.rlim_cur, DataBytes() + (size_t{1} << 30));
+        setrlimit(RLIMIT_DATA, &limit);
+        bool thrown = false;
+        try {
+            v.Reserve(size_t{1} << 33);
+        } catch (const std::bad_alloc&) {
+            thrown = true;
+        }
+        setrlimit(RLIMIT_DATA, &old_limit);
+        assert(thrown);
+        assert(v.Size() == 100 && v.Capacity() < (size_t{1} << 33));
+        assert(&v[0] == first);
+        v.Resize(size_t{1} << 20);
+        assert(&v[0] == first);
+    }
+}
+
+void Test14() {
+    {
+        Vector<int, std::allocator<int>, GoldenGrowth> v;
+        std::vector<size_t> capacities;
+        for (int i = 0; i < 20; ++i) {
+            const bool grows = v.Size() == v.Capacity();
+            v.PushBack(i);
+            if (grows) {
+                capacities.push_back(v.Capacity());
+            }
+        }
+        assert((capacities == std::vector<size_t>{1, 2, 3, 4, 6, 9, 13, 19, 28}));
+    }
+    {
+        using Policy = MinFirstCapacity<DoublingGrowth, 64>;
+        Vector<int, std::allocator<int>, Policy> v;
+        v.PushBack(1);
+        assert(v.Capacity() == 64 / sizeof(int));
+
+        Vector<int, std::allocator<int>, Policy> reserved;
+        reserved.Reserve(1);
+        assert(reserved.Capacity() == 64 / sizeof(int));
+        reserved.Reserve(100);
+        assert(reserved.Capacity() == 100);
+
+        Vector<int, std::allocator<int>, Policy> resized;
+        resized.Resize(3);
+        assert(resized.Capacity() == 64 / sizeof(int));
+        resized.Resize(17);
+        assert(resized.Capacity() == 32);
+    }
+    {
+        using Policy = CappedGrowth<DoublingGrowth, 1024 * sizeof(int)>;
+        Vector<int, std::allocator<int>, Policy> v;
+        v.Reserve(4096);
+        v.Resize(4096);
+        v.PushBack(1);
+        assert(v.Capacity() == 4096 + 1024);
+        v.Resize(10000);
+        assert(v.Capacity() == 10000);
+        v.PushBack(2);
+        assert(v.Capacity() == 11024);
+        assert(v[10000] == 2);
+    }
+    {
+        Vector<int> v(10);
+        v.Resize(11);
+        assert(v.Capacity() == 20);
+    }
+}
+
+// Element whose moves throw once `move_countdown` runs out
+struct ThrowingMove {
+    explicit ThrowingMove(int value) : value(value) { ++alive; }
+    ThrowingMove(const ThrowingMove& other) : value(other.value) { ++alive; }
+    ThrowingMove(ThrowingMove&& other) : value(other.value) {
+        if (move_countdown > 0 && --move_countdown == 0) {
+            throw std::runtime_error("Oops");
+        }
+        ++alive;
+    }
+    ThrowingMove& operator=(ThrowingMove&& other) {
+        if (move_countdown > 0 && --move_countdown == 0) {
+            throw std::runtime_error("Oops");
+        }
+        value = other.value;
+        return *this;
+    }
+    ~ThrowingMove() { --alive; }
+
+    int value;
+    static inline int alive = 0;
+    static inline int move_countdown = 0;
+};
+
+void Test15() {
+    const size_t SIZE = 10;
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        std::vector<Obj> source;
+        for (int i = 1; i <= 5; ++i) {
+            source.emplace_back(i);
+        }
+        const int old_num_moved = Obj::num_moved;
+        auto pos = v.Insert(v.cbegin() + 2, source.begin(), source.end());
+        assert(pos == v.begin() + 2);
+        assert(v.Size() == SIZE + 5);
+        assert(v.Capacity() == SIZE * 2);
+        assert(v[2].id == 1 && v[6].id == 5 && v[7].id == 0);
+        // One reallocation: every old element is moved exactly once
+        assert(Obj::num_moved - old_num_moved == static_cast<int>(SIZE));
+        assert(Obj::num_copied == 5);
+
+        v.Insert(v.cbegin() + 1, 3, Obj{7});
+        assert(v.Size() == SIZE + 8);
+        assert(v.Capacity() == SIZE * 2);
+        assert(v[1].id == 7 && v[3].id == 7 && v[4].id == 0 && v[5].id == 1);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        v[SIZE - 1].id = 1;
+        std::vector<Obj> source(3);
+        source[2].throw_on_copy = true;
+        try {
+            v.Insert(v.cbegin() + 1, source.begin(), source.end());
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == SIZE && v.Capacity() == SIZE);
+        v.Reserve(SIZE * 2);
+        try {
+            v.Insert(v.cbegin() + 1, source.begin(), source.end());
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        assert(v.Size() == SIZE);
+        assert(v[0].id == 0 && v[1].id == 0 && v[SIZE - 1].id == 1);
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(SIZE + 3));
     }
+    {
+        Vector<int> v;
+        for (int i = 0; i < 5; ++i) {
+            v.PushBack(i);
+        }
+        v.Reserve(100);
+        // Source ranges that alias the vector itself
+        v.Insert(v.cbegin() + 1, v.begin() + 2, v.end());
+        v.Append(v);
+        v.Insert(v.cbegin(), 2, v[4]);
+        const std::vector<int> expected{1, 1, 0, 2, 3, 4, 1, 2, 3, 4, 0, 2, 3, 4, 1, 2, 3, 4};
+        assert(v.Size() == expected.size());
+        assert(std::equal(v.begin(), v.end(), expected.begin()));
+
+        std::list<int> list{7, 8, 9};
+        v.Append(list);
+        std::istringstream input("5 6");
+        v.Insert(v.cbegin(), std::istream_iterator<int>(input), std::istream_iterator<int>());
+        assert(v[0] == 5 && v[1] == 6 && v[v.Size() - 1] == 9);
+    }
+    {
+        Vector<std::unique_ptr<int>> moved;
+        moved.PushBack(std::make_unique<int>(1));
+        Vector<std::unique_ptr<int>> source;
+        source.PushBack(std::make_unique<int>(2));
+        source.PushBack(std::make_unique<int>(3));
+        moved.Append(std::move(source));
+        assert(moved.Size() == 3 && *moved[2] == 3);
+        assert(source[0] == nullptr);
+    }
+    {
+        // A move throwing while the new elements are rotated into place
+        // must not leak the ones built past the end
+        {
+            Vector<ThrowingMove> v;
+            v.Reserve(SIZE * 2);
+            for (int i = 0; i < static_cast<int>(SIZE); ++i) {
+                v.EmplaceBack(i);
+            }
+            ThrowingMove::move_countdown = 4;
+            try {
+                v.Insert(v.cbegin() + 1, 3, ThrowingMove(-1));
+                assert(false && "Exception is expected");
+            } catch (const std::runtime_error&) {
+            }
+            ThrowingMove::move_countdown = 0;
+            assert(v.Size() == SIZE);
+            assert(ThrowingMove::alive == static_cast<int>(SIZE));
+        }
+        assert(ThrowingMove::alive == 0);
+    }
+}
+
+void Test16() {
+    const int SIZE = 20;
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        auto pos = v.Erase(v.cbegin() + 5, v.cbegin() + 8);
+        assert(pos->id == 8);
+        assert(v.Size() == SIZE - 3);
+        assert(Obj::num_move_assigned == SIZE - 8);
+        assert(v.Erase(v.cbegin() + 2, v.cbegin() + 2) == v.begin() + 2);
+
+        const size_t removed = EraseIf(v, [](const Obj& obj) {
+            return obj.id % 2 == 1;
+        });
+        assert(removed == 8);
+        assert(v.Size() == SIZE - 11);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            assert(v[i].id % 2 == 0);
+        }
+
+        pos = v.SwapErase(v.cbegin() + 1);
+        assert(pos->id == 18);
+        assert(v[v.Size() - 1].id == 16);
+        pos = v.SwapErase(v.cend() - 1);
+        assert(pos == v.end());
+        assert(Obj::GetAliveObjectCount() == static_cast<int>(v.Size()));
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+    {
+        Vector<Relocatable> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.EmplaceBack(i);
+        }
+        const int old_num_moved = Relocatable::num_moved;
+        v.Erase(v.cbegin(), v.cbegin() + 3);
+        assert(*v[0].value == 3);
+        const size_t removed = EraseIf(v, [](const Relocatable& r) {
+            return *r.value % 3 != 0;
+        });
+        assert(removed == 11);
+        assert(v.Size() == 6);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            assert(*v[i].value == static_cast<int>(3 * (i + 1)));
+        }
+        v.SwapErase(v.cbegin());
+        assert(*v[0].value == 18 && v.Size() == 5);
+        assert(Relocatable::num_moved == old_num_moved);
+    }
+    {
+        Vector<int> v;
+        for (int i = 0; i < SIZE; ++i) {
+            v.PushBack(i);
+        }
+        try {
+            EraseIf(v, [](int value) {
+                if (value == 10) {
+                    throw std::runtime_error("Oops");
+                }
+                return value % 2 == 0;
+            });
+            assert(false && "Exception is expected");
+        } catch (const std::runtime_error&) {
+        }
+        // Elements examined before the exception were compacted, the rest kept
+        assert(v.Size() == 15);
+        assert(v[0] == 1 && v[4] == 9 && v[5] == 10 && v[14] == 19);
+    }
+}
+
+void Test17() {
+    {
+        Vector<unsigned char> v(100);
+        std::fill(v.begin(), v.end(), 0xAB);
+        v.Resize(0);
+        unsigned char* region = v.ResizeDefaultInit(100);
+        assert(region == v.begin());
+        // Default initialization leaves the previous bytes untouched
+        assert(std::all_of(v.begin(), v.end(), [](unsigned char c) {
+            return c == 0xAB;
+        }));
+        v.Resize(0);
+        v.Resize(100);
+        assert(v[0] == 0 && v[99] == 0);
+    }
+    {
+        Vector<int> v;
+        for (int batch = 0; batch < 3; ++batch) {
+            int* out = v.AppendUninitialized(4);
+            assert(out == v.end() - 4);
+            for (int i = 0; i < 4; ++i) {
+                out[i] = batch * 4 + i;
+            }
+        }
+        assert(v.Size() == 12);
+        assert(v.Capacity() == 16);
+        for (int i = 0; i < 12; ++i) {
+            assert(v[i] == i);
+        }
+        assert(v.ResizeDefaultInit(5) == v.end());
+        // A count that would wrap the size around throws and keeps the elements
+        try {
+            v.AppendUninitialized(size_t(-1) - 2);
+            assert(false && "Exception is expected");
+        } catch (const std::bad_alloc&) {
+        }
+        assert(v.Size() == 5 && v[4] == 4);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v;
+        Obj* out = v.AppendUninitialized(3);
+        assert(Obj::num_default_constructed == 3);
+        assert(out == v.begin());
+        out[2].id = 1;
+        v.AppendUninitialized(1);
+        assert(v[2].id == 1 && v.Size() == 4);
+    }
+    assert(Obj::GetAliveObjectCount() == 0);
+}
+
+void Test18() {
+    const size_t SIZE = 10;
+    {
+        Vector<int> v;
+        for (int i = 0; i < 100; ++i) {
+            v.PushBack(i);
+        }
+        v.Resize(10);
+        assert(v.Capacity() == 128);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 10);
+        assert(v[9] == 9);
+        v.Resize(0);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 0 && v.begin() == nullptr);
+    }
+    {
+        Obj::ResetCounters();
+        Vector<Obj> v(SIZE);
+        v.Reserve(50);
+        v.ShrinkToFit();
+        assert(v.Capacity() == SIZE && v.Size() == SIZE);
+        assert(Obj::GetAliveObjectCount() == SIZE);
+    }
+    {
+        // MallocAllocator shrinks relocatable buffers with realloc
+        Vector<int, MallocAllocator<int>> v(1000);
+        v[999] = 7;
+        v.Resize(500);
+        v.ShrinkToFit();
+        assert(v.Capacity() == 500 && v[0] == 0);
+    }
+    {
+        // No shrink below 4 KiB; below a quarter of the capacity the buffer
+        // shrinks to twice the size, so pops and pushes around that size
+        // do not reallocate again
+        using Policy = HysteresisShrink<DoublingGrowth>;
+        Vector<int, std::allocator<int>, Policy> v;
+        v.Resize(4096);
+        v.Resize(1025);
+        assert(v.Capacity() == 4096);
+        v.PopBack();
+        assert(v.Capacity() == 4096);
+        v.PopBack();
+        assert(v.Capacity() == 2046 && v.Size() == 1023);
+        assert(v[1022] == 0);
+        for (int i = 0; i < 100; ++i) {
+            v.PushBack(i);
+            v.PopBack();
+        }
+        assert(v.Capacity() == 2046);
+        v.Erase(v.begin() + 100, v.end());
+        assert(v.Capacity() == 1024);
+        EraseIf(v, [](int) { return true; });
+        assert(v.Size() == 0 && v.Capacity() == 1024);
+    }
+    {
+        using Policy = HysteresisShrink<DoublingGrowth, 1, 4, 0>;
+        Obj::ResetCounters();
+        Vector<Obj, std::allocator<Obj>, Policy> v(64);
+        v[0].id = 42;
+        auto it = v.SwapErase(v.begin() + 5);
+        assert(it == v.begin() + 5);
+        v.Erase(v.begin() + 16, v.end());
+        assert(v.Capacity() == 64);
+        it = v.Erase(v.begin() + 1);
+        assert(v.Size() == 15 && v.Capacity() == 30);
+        assert(it == v.begin() + 1 && v[0].id == 42);
+        v.Resize(0);
+        assert(v.Capacity() == 0);
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+}
+
+struct alignas(128) Overaligned {
+    int value = 0;
+};
+
+void Test19() {
+    {
+        Vector<float, Aligned<64>> v;
+        static_assert(std::is_same_v<decltype(v)::allocator_type, AlignedAllocator<float, 64>>);
+        for (int i = 0; i < 1000; ++i) {
+            v.PushBack(static_cast<float>(i));
+            assert(IsAligned(v.begin(), 64));
+        }
+        v.Insert(v.begin(), 10, 1.0f);
+        v.ShrinkToFit();
+        assert(IsAligned(v.begin(), 64));
+        assert(v[10] == 0.0f && v[1009] == 999.0f);
+    }
+    {
+        // The element type's own alignment wins if it is larger
+        Vector<Overaligned, Aligned<16>> v(3);
+        assert(IsAligned(v.begin(), 128));
+        Vector<Overaligned> plain(3);
+        assert(IsAligned(plain.begin(), 128));
+    }
+    {
+        Vector<double, Aligned<4096>> a(1);
+        Vector<double, Aligned<4096>> b(a);
+        b.PushBack(2.0);
+        a = std::move(b);
+        assert(IsAligned(a.begin(), 4096) && a.Size() == 2 && a[1] == 2.0);
+    }
+}
+
+template <typename T>
+void CheckSimdKernels() {
+    auto close = [](T actual, T expected) {
+        const double diff = static_cast<double>(actual) - static_cast<double>(expected);
+        return std::abs(diff) <= 1e-4 * (1.0 + std::abs(static_cast<double>(expected)));
+    };
+    for (size_t size : {1, 3, 7, 16, 33, 100, 1027}) {
+        Vector<T> a(size);
+        Vector<T> b(size);
+        for (size_t i = 0; i < size; ++i) {
+            a[i] = static_cast<T>(static_cast<int>(i * 37 % 101) - 50);
+            b[i] = static_cast<T>(static_cast<int>(i * 11 % 23) - 7);
+        }
+        T sum = 0;
+        T dot = 0;
+        size_t arg_min = 0;
+        size_t arg_max = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += a[i];
+            dot += a[i] * b[i];
+            arg_min = a[i] < a[arg_min] ? i : arg_min;
+            arg_max = a[arg_max] < a[i] ? i : arg_max;
+        }
+        assert(close(Simd::Sum(a), sum));
+        assert(close(Simd::Dot(a, b), dot));
+        assert(Simd::Min(a) == a[arg_min] && Simd::ArgMin(a) == arg_min);
+        assert(Simd::Max(a) == a[arg_max] && Simd::ArgMax(a) == arg_max);
+
+        Vector<T> out(size);
+        Simd::Add(a, b, out);
+        for (size_t i = 0; i < size; ++i) {
+            assert(out[i] == a[i] + b[i]);
+        }
+        Simd::Mul(a, b, out);
+        for (size_t i = 0; i < size; ++i) {
+            assert(out[i] == a[i] * b[i]);
+        }
+        Vector<T> y(b);
+        Simd::Axpy(T(3), a, y);
+        for (size_t i = 0; i < size; ++i) {
+            assert(y[i] == b[i] + T(3) * a[i]);
+        }
+        Simd::Scale(y, T(2));
+        for (size_t i = 0; i < size; ++i) {
+            assert(y[i] == T(2) * (b[i] + T(3) * a[i]));
+        }
+        Simd::Fill(y.begin() + 1, size - 1, T(5));
+        assert(y[0] == T(2) * (b[0] + T(3) * a[0]));
+        assert(std::all_of(y.begin() + 1, y.end(), [](T x) { return x == T(5); }));
+    }
+}
+
+void Test20() {
+    const SimdLevel supported = Simd::SupportedLevel();
+    assert(Simd::ActiveLevel() == supported);
+    for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2, SimdLevel::kAvx512}) {
+        if (level > supported) {
+            continue;
+        }
+        Simd::SetLevel(level);
+        assert(Simd::ActiveLevel() == level);
+        CheckSimdKernels<float>();
+        CheckSimdKernels<double>();
+        CheckSimdKernels<int32_t>();
+        {
+            // Integer sums wrap around
+            Vector<int32_t> v(64);
+            Simd::Fill(v, int32_t{1} << 30);
+            assert(Simd::Sum(v) == 0);
+        }
+        {
+            // 16-bit products wrap too, including in the scalar tails
+            Vector<uint16_t> v(37);
+            Simd::Fill(v, uint16_t{65535});
+            assert(Simd::Dot(v, v) == 37);
+            Vector<uint16_t> out(v.Size());
+            Simd::Mul(v, v, out);
+            assert(std::all_of(out.begin(), out.end(), [](uint16_t x) { return x == 1; }));
+            Simd::Scale(v, uint16_t{65535});
+            assert(std::all_of(v.begin(), v.end(), [](uint16_t x) { return x == 1; }));
+        }
+        {
+            Vector<float, Aligned<64>> v(1000);
+            Simd::Fill(v, 0.5f);
+            v[700] = -1.0f;
+            assert(Simd::Sum(v) == 498.5f);
+            assert(Simd::ArgMin(v) == 700);
+        }
+    }
+    Simd::SetLevel(supported);
+}
+
+void Test21() {
+    for (size_t threads : {1, 2, 4}) {
+        ThreadPool pool(threads);
+        assert(pool.ThreadCount() == threads);
+        for (size_t grain : {0, 1, 7, 1000}) {
+            const ParallelOptions options{grain, &pool};
+            Vector<int> v(10007);
+            for (size_t i = 0; i < v.Size(); ++i) {
+                v[i] = static_cast<int>(i);
+            }
+            ParallelForEach(v, [](int& x) { x *= 2; }, options);
+            for (size_t i = 0; i < v.Size(); ++i) {
+                assert(v[i] == static_cast<int>(2 * i));
+            }
+            const long long sum = ParallelReduce(v, 0LL, std::plus<>(), options);
+            assert(sum == 10006LL * 10007);
+            const size_t multiples_of_three = ParallelReduce(
+                v, size_t{0}, [](size_t acc, int x) { return acc + (x % 3 == 0); }, std::plus<>(), options);
+            assert(multiples_of_three == 3336);
+
+            Vector<double> halves(v.Size());
+            ParallelTransform(v, halves, [](int x) { return x / 2.0; }, options);
+            for (size_t i = 0; i < v.Size(); ++i) {
+                assert(halves[i] == static_cast<double>(i));
+            }
+        }
+        {
+            Vector<int> empty;
+            ParallelForEach(empty, [](int&) { assert(false); }, {0, &pool});
+            assert(ParallelReduce(empty, 5, std::plus<>(), {0, &pool}) == 5);
+        }
+        {
+            // Nested loops run on the same pool without deadlocking
+            Vector<Vector<int>> rows(16);
+            ParallelForEach(rows, [&pool](Vector<int>& row) {
+                row.Resize(1000);
+                ParallelForEach(row, [](int& x) { x = 1; }, {10, &pool});
+            }, {1, &pool});
+            assert(ParallelReduce(rows, 0, [](int acc, const Vector<int>& row) {
+                return acc + Simd::Sum(row);
+            }, std::plus<>(), {1, &pool}) == 16000);
+        }
+        {
+            Vector<int> v(1000);
+            bool thrown = false;
+            try {
+                ParallelForEach(v, [&v](int& x) {
+                    if (&x == v.begin() + 500) {
+                        throw std::runtime_error("failed");
+                    }
+                }, {10, &pool});
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown);
+        }
+        {
+            // With a fixed grain size the floating-point result is the same
+            // for any number of threads
+            Vector<double> values(100000);
+            for (size_t i = 0; i < values.Size(); ++i) {
+                values[i] = 1.0 / (i + 1);
+            }
+            const double expected = ParallelReduce(values, 0.0, std::plus<>(), {256, nullptr});
+            assert(ParallelReduce(values, 0.0, std::plus<>(), {256, &pool}) == expected);
+        }
+    }
+}
+
+struct Record {
+    Record(int producer, int sequence)
+        : producer(producer)
+        , sequence(sequence)
+        , checksum(producer * 100003 + sequence) {
+    }
+
+    int producer;
+    int sequence;
+    int checksum;
+};
+
+struct ThrowingRecord {
+    explicit ThrowingRecord(int value)
+        : value(value) {
+        if (value < 0) {
+            throw std::runtime_error("negative");
+        }
+    }
+
+    int value;
+};
+
+// Allocator that throws std::bad_alloc while `fail` is set
+template <typename T>
+struct FlakyAllocator {
+    using value_type = T;
+
+    FlakyAllocator() = default;
+    template <typename U>
+    FlakyAllocator(const FlakyAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (fail) {
+            throw std::bad_alloc();
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, size_t n) noexcept { std::allocator<T>().deallocate(p, n); }
+
+    template <typename U>
+    bool operator==(const FlakyAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const FlakyAllocator<U>&) const noexcept { return false; }
+
+    static inline bool fail = false;
+};
+
+void Test22() {
+    {
+        const int kProducers = 8;
+        const int kRecords = 20000;
+        ConcurrentVector<Record> records;
+        records.EmplaceBack(-1, 0);
+        const Record* first = &records[0];
+        std::atomic<bool> done{false};
+        std::thread reader([&] {
+            while (!done.load()) {
+                size_t count = 0;
+                for (const Record& record : records) {
+                    assert(record.checksum == record.producer * 100003 + record.sequence);
+                    ++count;
+                }
+                assert(count <= records.Size());
+            }
+        });
+        Vector<std::thread> producers;
+        for (int p = 0; p < kProducers; ++p) {
+            producers.EmplaceBack([&records, p] {
+                for (int i = 0; i < kRecords; ++i) {
+                    Record& record = records.EmplaceBack(p, i);
+                    assert(record.producer == p && record.sequence == i);
+                }
+            });
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        done = true;
+        reader.join();
+
+        assert(records.Size() == kProducers * kRecords + 1);
+        assert(&records[0] == first);
+        Vector<int> next(kProducers);
+        for (size_t i = 1; i < records.Size(); ++i) {
+            // Each producer's records appear in the order it appended them
+            const Record& record = records[i];
+            assert(record.sequence == next[record.producer]++);
+        }
+    }
+    {
+        Obj::ResetCounters();
+        {
+            ConcurrentVector<Obj> v;
+            v.Reserve(1000);
+            for (int i = 0; i < 1000; ++i) {
+                v.EmplaceBack(i);
+            }
+            assert(v.Size() == 1000);
+            assert(v[999].id == 999);
+            assert(Obj::GetAliveObjectCount() == 1000);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        ConcurrentVector<ThrowingRecord> v;
+        v.EmplaceBack(1);
+        try {
+            v.EmplaceBack(-1);
+            assert(false);
+        } catch (const std::runtime_error&) {
+        }
+        v.EmplaceBack(2);
+        // The failed slot is a tombstone, and later elements are published
+        assert(v.Size() == 3);
+        assert(v.IsTombstone(1) && !v.IsTombstone(2));
+        assert(v[2].value == 2);
+        Vector<int> values;
+        for (const ThrowingRecord& record : v) {
+            values.PushBack(record.value);
+        }
+        assert(values.Size() == 2 && values[0] == 1 && values[1] == 2);
+    }
+    {
+        // A failed segment allocation throws before claiming a slot
+        using Alloc = FlakyAllocator<ThrowingRecord>;
+        ConcurrentVector<ThrowingRecord, Alloc> v;
+        v.EmplaceBack(1);
+        Alloc::fail = true;
+        size_t size = 1;
+        try {
+            for (;; ++size) {
+                v.EmplaceBack(1);
+            }
+        } catch (const std::bad_alloc&) {
+        }
+        Alloc::fail = false;
+        v.EmplaceBack(2);
+        assert(v.Size() == size + 1 && v[size].value == 2);
+        for (size_t i = 0; i < v.Size(); ++i) {
+            assert(!v.IsTombstone(i));
+        }
+    }
+}
+
+void Test23() {
+    const size_t SIZE = 10;
+    {
+        StableVector<int> v;
+        v.PushBack(0);
+        const int* first = &v[0];
+        Vector<const int*> addresses;
+        for (int i = 1; i < 100000; ++i) {
+            v.PushBack(i);
+            addresses.PushBack(&v[i]);
+        }
+        assert(v.Size() == 100000);
+        assert(&v[0] == first);
+        for (int i = 1; i < 100000; ++i) {
+            assert(addresses[i - 1] == &v[i] && v[i] == i);
+        }
+        // Appending one of its own elements never reads a moved-from value
+        while (v.Size() < v.Capacity()) {
+            v.PushBack(1);
+        }
+        v.PushBack(v[0]);
+        assert(v[v.Size() - 1] == 0);
+
+        long long sum = 0;
+        for (int x : v) {
+            sum += x;
+        }
+        assert(sum == std::accumulate(v.begin(), v.end(), 0LL));
+        std::sort(v.begin(), v.end(), std::greater<>());
+        assert(std::is_sorted(v.begin(), v.end(), std::greater<>()));
+        assert(v.end() - v.begin() == static_cast<std::ptrdiff_t>(v.Size()));
+    }
+    {
+        Obj::ResetCounters();
+        {
+            StableVector<Obj> v(SIZE);
+            assert(Obj::num_default_constructed == SIZE);
+            v.EmplaceBack(7);
+            StableVector<Obj> copy(v);
+            assert(copy.Size() == SIZE + 1 && copy[SIZE].id == 7);
+            StableVector<Obj> moved(std::move(copy));
+            assert(copy.Size() == 0 && moved.Size() == SIZE + 1);
+            const Obj* last = &moved[SIZE];
+            v = std::move(moved);
+            assert(&v[SIZE] == last);
+            v.Resize(3);
+            assert(Obj::GetAliveObjectCount() == 3);
+            v = StableVector<Obj>(2);
+            assert(v.Size() == 2);
+        }
+        assert(Obj::GetAliveObjectCount() == 0);
+    }
+    {
+        MonotonicArena arena;
+        StableVector<std::string, ArenaAllocator<std::string>> v{ArenaAllocator<std::string>(arena)};
+        for (int i = 0; i < 1000; ++i) {
+            v.EmplaceBack(std::to_string(i));
+        }
+        assert(v[999] == "999");
+        assert(arena.BytesAllocated() >= 1000 * sizeof(std::string));
+    }
+}
+
+struct PackedRecord {
+    uint64_t key;
+    double value;
+};
+
+void Test24() {
+    const std::string path = "/tmp/vector_test_" + std::to_string(getpid()) + ".vec";
+    unlink(path.c_str());
+    {
+        MappedVector<PackedRecord> table = OpenMappedVector<PackedRecord>(path);
+        assert(table.Size() == 0);
+        for (uint64_t i = 0; i < 100000; ++i) {
+            table.PushBack(PackedRecord{i, i * 0.5});
+        }
+        Flush(table);
+        // Elements appended after the last Flush are not recorded
+        table.PushBack(PackedRecord{0, 0.0});
+    }
+    {
+        MappedVector<PackedRecord> table = OpenMappedVector<PackedRecord>(path);
+        assert(table.Size() == 100000);
+        for (uint64_t i = 0; i < table.Size(); ++i) {
+            assert(table[i].key == i && table[i].value == i * 0.5);
+        }
+        table.Resize(50000);
+        table[0].value = -1.0;
+        Flush(table);
+
+        // Copies live in anonymous memory and leave the file alone
+        MappedVector<PackedRecord> copy(table);
+        assert(copy.GetAllocator().File() == nullptr);
+        copy[0].value = 42.0;
+        copy.PushBack(PackedRecord{1, 1.0});
+        assert(table[0].value == -1.0);
+    }
+    {
+        MappedVector<PackedRecord> table = OpenMappedVector<PackedRecord>(path);
+        assert(table.Size() == 50000 && table[0].value == -1.0 && table[49999].key == 49999);
+    }
+    const std::string other_path = path + ".other";
+    unlink(other_path.c_str());
+    {
+        // Assignment copies into the target's own file instead of sharing
+        // the source's pages
+        MappedVector<PackedRecord> table = OpenMappedVector<PackedRecord>(path);
+        MappedVector<PackedRecord> other = OpenMappedVector<PackedRecord>(other_path);
+        other.PushBack(PackedRecord{7, 7.0});
+        other = table;
+        assert(other.GetAllocator().File() != table.GetAllocator().File());
+        other[0].value = 3.0;
+        assert(table[0].value == -1.0);
+        assert(other.Size() == 50000 && other[49999].key == 49999);
+        Flush(other);
+
+        MappedVector<PackedRecord> moved = OpenMappedVector<PackedRecord>(other_path + ".moved");
+        const auto moved_file = moved.GetAllocator().File();
+        moved = std::move(other);
+        assert(moved.GetAllocator().File() == moved_file && moved[0].value == 3.0);
+        unlink((other_path + ".moved").c_str());
+    }
+    {
+        MappedVector<PackedRecord> other = OpenMappedVector<PackedRecord>(other_path);
+        assert(other.Size() == 50000 && other[0].value == 3.0 && other[49999].key == 49999);
+        MappedVector<PackedRecord> table = OpenMappedVector<PackedRecord>(path);
+        assert(table[0].value == -1.0);
+    }
+    unlink(other_path.c_str());
+    const std::string ints_path = path + ".ints";
+    unlink(ints_path.c_str());
+    {
+        // Temporaries and relocation targets get their own memory while the
+        // vector maps the file
+        auto check = [&ints_path](int size, auto change, std::initializer_list<int> expected) {
+            unlink(ints_path.c_str());
+            {
+                MappedVector<int> vec = OpenMappedVector<int>(ints_path);
+                vec.Reserve(size);
+                for (int i = 0; i < size; ++i) {
+                    vec.PushBack(i);
+                }
+                change(vec);
+                assert(std::equal(vec.begin(), vec.end(), expected.begin(), expected.end()));
+                Flush(vec);
+                // A vector that left the file moves back when it grows
+                vec.Reserve(vec.Capacity() * 2);
+                assert(vec.GetAllocator().File()->Owns(vec.begin()));
+                assert(std::equal(vec.begin(), vec.end(), expected.begin(), expected.end()));
+            }
+            const MappedVector<int> stored = OpenMappedVector<int>(ints_path);
+            assert(std::equal(stored.begin(), stored.end(), expected.begin(), expected.end()));
+        };
+        check(4, [](MappedVector<int>& vec) {
+            const int inserted[] = {100, 101, 102};
+            vec.Insert(vec.cbegin() + 1, std::begin(inserted), std::end(inserted));
+        }, {0, 100, 101, 102, 1, 2, 3});
+        check(8, [](MappedVector<int>& vec) {
+            vec.Insert(vec.cbegin() + 2, 3, 42);
+        }, {0, 1, 42, 42, 42, 2, 3, 4, 5, 6, 7});
+        check(8, [](MappedVector<int>& vec) {
+            std::istringstream input("7 8 9");
+            vec.Insert(vec.cbegin() + 5, std::istream_iterator<int>(input), std::istream_iterator<int>());
+        }, {0, 1, 2, 3, 4, 7, 8, 9, 5, 6, 7});
+        check(3, [](MappedVector<int>& vec) {
+            Vector<int> source;
+            for (int i = 0; i < 5; ++i) {
+                source.PushBack(i * 10);
+            }
+            std::stringstream stream;
+            Save(stream, source);
+            Load(stream, vec);
+        }, {0, 10, 20, 30, 40});
+
+        // A load that fails its checksum leaves the mapped vector alone
+        check(4, [](MappedVector<int>& vec) {
+            std::stringstream stream;
+            Save(stream, Vector<int>(100));
+            std::string corrupt = stream.str();
+            corrupt[sizeof(SerialHeader) + 7] ^= 1;
+            std::istringstream in(corrupt);
+            bool thrown = false;
+            try {
+                Load(in, vec);
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+            assert(thrown);
+            assert(vec.GetAllocator().File()->Owns(vec.begin()));
+        }, {0, 1, 2, 3});
+    }
+    unlink(ints_path.c_str());
+    bool thrown = false;
+    try {
+        OpenMappedVector<int>(path);
+    } catch (const std::runtime_error&) {
+        thrown = true;
+    }
+    assert(thrown);
+    unlink(path.c_str());
+}
+
+template <typename V>
+std::string SaveToString(const V& vec) {
+    std::ostringstream out;
+    Save(out, vec);
+    return out.str();
+}
+
+template <typename V>
+V LoadFromString(const std::string& bytes) {
+    std::istringstream in(bytes);
+    V vec;
+    Load(in, vec);
+    return vec;
+}
+
+void Test25() {
+    {
+        Vector<double> values(1000);
+        for (size_t i = 0; i < values.Size(); ++i) {
+            values[i] = i * 0.25;
+        }
+        const std::string bytes = SaveToString(values);
+        assert(bytes.size() == sizeof(SerialHeader) + 1000 * sizeof(double));
+        const auto loaded = LoadFromString<Vector<double>>(bytes);
+        assert(std::equal(loaded.begin(), loaded.end(), values.begin(), values.end()));
+
+        // The view points into the buffer instead of copying
+        Vector<unsigned char, Aligned<64>> buffer(bytes.size());
+        std::memcpy(buffer.begin(), bytes.data(), bytes.size());
+        const VectorView<double> view = View<double>(buffer.begin(), buffer.Size());
+        assert(view.Size() == 1000 && view[999] == 999 * 0.25);
+        assert(reinterpret_cast<const unsigned char*>(view.begin()) == buffer.begin() + sizeof(SerialHeader));
+
+        bool thrown = false;
+        try {
+            View<float>(buffer.begin(), buffer.Size());
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        assert(thrown);
+    }
+    {
+        Vector<std::string> words;
+        for (const char* word : {"", "a", "stable", "vector"}) {
+            words.PushBack(word);
+        }
+        const auto loaded = LoadFromString<Vector<std::string>>(SaveToString(words));
+        assert(std::equal(loaded.begin(), loaded.end(), words.begin(), words.end()));
+
+        Vector<Vector<int>> rows(3);
+        rows[1].PushBack(1);
+        rows[2].Resize(100);
+        rows[2][99] = 99;
+        const auto loaded_rows = LoadFromString<Vector<Vector<int>>>(SaveToString(rows));
+        assert(loaded_rows.Size() == 3 && loaded_rows[0].Size() == 0);
+        assert(loaded_rows[1][0] == 1 && loaded_rows[2][99] == 99);
+
+        Vector<Vector<std::string>> nested(2);
+        nested[1] = words;
+        const auto loaded_nested = LoadFromString<Vector<Vector<std::string>>>(SaveToString(nested));
+        assert(loaded_nested[1].Size() == 4 && loaded_nested[1][3] == "vector");
+    }
+    {
+        Vector<int> original(100);
+        original[50] = 7;
+        const std::string bytes = SaveToString(original);
+        auto expect_failure = [](const std::string& data) {
+            Vector<int> target(1);
+            std::istringstream in(data);
+            try {
+                Load(in, target);
+            } catch (const std::runtime_error&) {
+                assert(target.Size() == 1);
+                return;
+            }
+            assert(false);
+        };
+        std::string corrupt = bytes;
+        corrupt[sizeof(SerialHeader) + 3] ^= 1;
+        expect_failure(corrupt);
+        expect_failure(bytes.substr(0, bytes.size() - 1));
+        expect_failure(bytes.substr(0, 10));
+        expect_failure(SaveToString(Vector<unsigned>(100)));
+        expect_failure(SaveToString(Vector<std::string>(1)));
+
+        SerialChecksum whole;
+        whole.Update(bytes.data(), bytes.size());
+        SerialChecksum pieces;
+        for (size_t i = 0; i < bytes.size(); i += 5) {
+            pieces.Update(bytes.data() + i, std::min<size_t>(5, bytes.size() - i));
+        }
+        assert(whole.Finish() == pieces.Finish());
+    }
+}
+
+struct ThrowingCopy {
+    ThrowingCopy() = default;
+    explicit ThrowingCopy(int value) : value(value) {}
+    ThrowingCopy(const ThrowingCopy& other) : value(other.value) {
+        if (other.value < 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+
+    int value = 0;
+};
+
+void Test26() {
+    {
+        SoAVector<int, double, std::string> soa;
+        for (int i = 0; i < 100; ++i) {
+            soa.EmplaceBack(i, i * 0.5, std::to_string(i));
+        }
+        assert(soa.Size() == 100 && soa.Capacity() >= 100);
+        assert(soa[7].Get<0>() == 7 && soa[7].Get<2>() == "7");
+        ColumnSpan<double> halves = soa.Column<1>();
+        assert(halves.Size() == 100);
+        assert(Simd::Sum(halves.Data(), halves.Size()) == 2475.0);
+
+        soa[3] = std::make_tuple(-3, 1.5, std::string("three"));
+        std::tuple<int, double, std::string> row = soa[3];
+        assert(std::get<0>(row) == -3 && std::get<2>(row) == "three");
+        soa[4] = soa[3];
+        assert(soa[4].Get<2>() == "three");
+
+        auto it = soa.Erase(soa.begin() + 10, soa.begin() + 20);
+        assert(soa.Size() == 90 && (*it).Get<0>() == 20);
+        it = soa.Erase(soa.begin());
+        assert((*it).Get<0>() == 1 && soa.Size() == 89);
+
+        int sum = 0;
+        for (auto r : soa) {
+            sum += r.Get<0>();
+            r.Get<1>() = 0;
+        }
+        // Rows 10..19 were erased and rows 3 and 4 now hold -3
+        assert(sum == 4950 - 145 - 3 - 4 - 3 - 3);
+        assert(Simd::Sum(soa.Column<1>().Data(), soa.Size()) == 0.0);
+
+        const auto copy = soa;
+        assert(copy.Size() == soa.Size() && copy[88].Get<2>() == soa[88].Get<2>());
+        soa.Resize(5);
+        assert(soa.Size() == 5 && copy.Size() == 89);
+        soa.Resize(8);
+        assert(soa[7].Get<0>() == 0 && soa[7].Get<2>().empty());
+        soa.PushBack(copy[1]);
+        assert(soa[8].Get<0>() == copy[1].Get<0>());
+        soa.Clear();
+        assert(soa.Size() == 0);
+    }
+    {
+        // A throwing field leaves the vector unchanged
+        SoAVector<std::string, ThrowingCopy> soa;
+        soa.Reserve(2);
+        soa.EmplaceBack("a", 1);
+        soa.EmplaceBack("b", -1);
+        const size_t capacity = soa.Capacity();
+        try {
+            soa.EmplaceBack("c", ThrowingCopy(-2));
+            assert(false);
+        } catch (const std::runtime_error&) {
+        }
+        assert(soa.Size() == 2 && soa.Capacity() == capacity);
+        assert(soa[0].Get<0>() == "a" && soa[1].Get<1>().value == -1);
+        soa[1].Get<1>().value = 2;
+        soa.EmplaceBack("c", 3);
+        assert(soa.Size() == 3 && soa[2].Get<0>() == "c" && soa[0].Get<1>().value == 1);
+    }
+}
+
+void Test27() {
+    {
+        BitVector bits;
+        std::vector<bool> expected;
+        for (size_t i = 0; i < 1000; ++i) {
+            const bool value = i % 3 == 0 || i % 7 == 0;
+            bits.PushBack(value);
+            expected.push_back(value);
+        }
+        assert(bits.Size() == 1000 && bits.Capacity() >= 1000);
+        assert(bits.Count() == size_t(std::count(expected.begin(), expected.end(), true)));
+        for (size_t i = 0; i < bits.Size(); ++i) {
+            assert(bits[i] == expected[i]);
+        }
+
+        bits[1] = true;
+        bits[0] = bits[2];
+        bits.Flip(3);
+        assert(bits[1] && !bits[0] && !bits[3]);
+        assert(bits.FindFirst() == 1 && bits.FindNext(1) == 6 && bits.FindNext(6) == 7);
+        assert(bits.FindNext(999) == BitVector::kNpos);
+
+        size_t visited = 0;
+        size_t previous = 0;
+        for (size_t index : bits.SetBits()) {
+            assert(bits[index] && (visited == 0 || index > previous));
+            previous = index;
+            ++visited;
+        }
+        assert(visited == bits.Count());
+
+        bits.PopBack();
+        bits.Resize(1003, true);
+        assert(bits.Size() == 1003 && bits[999] && bits[1002]);
+        bits.Resize(10);
+        assert(bits.Size() == 10 && bits.FindNext(9) == BitVector::kNpos);
+        bits.Resize(200);
+        assert(bits.FindNext(9) == BitVector::kNpos && bits.Count() == 4);
+    }
+    {
+        const size_t kSize = 777;
+        BitVector a(kSize), b(kSize, true);
+        for (size_t i = 0; i < kSize; i += 2) {
+            a.Set(i);
+        }
+        assert(a.Count() == 389 && b.Count() == kSize);
+        assert((a & b) == a && (a | b) == b);
+        assert((a ^ b).Count() == kSize - 389 && (a ^ b) == ~a);
+        assert((~b).Count() == 0 && !(~b).Any());
+        assert(~~a == a);
+
+        BitVector c = a;
+        c &= ~a;
+        assert(c.Count() == 0);
+        c.Fill(true);
+        assert(c == b);
+
+        for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2, SimdLevel::kAvx512}) {
+            Simd::SetLevel(level);
+            assert(a.Count() == 389 && (a | ~a) == b);
+        }
+        Simd::SetLevel(Simd::SupportedLevel());
+    }
+}
+
+void Test28() {
+    std::mt19937_64 random(28);
+    for (double density : {0.0, 0.001, 0.5, 0.97, 1.0}) {
+        for (size_t size : {size_t{0}, size_t{1}, size_t{2048}, size_t{100000}}) {
+            BitVector bits(size);
+            std::bernoulli_distribution coin(density);
+            for (size_t i = 0; i < size; ++i) {
+                bits[i] = coin(random);
+            }
+            RankSelect index(bits);
+            size_t ones = 0;
+            for (size_t i = 0; i < size; ++i) {
+                assert(index.Rank1(i) == ones);
+                assert(index.Rank0(i) == i - ones);
+                if (bits[i]) {
+                    assert(index.Select1(ones) == i);
+                } else {
+                    assert(index.Select0(i - ones) == i);
+                }
+                ones += bits[i];
+            }
+            assert(index.Rank1(size) == ones && index.Ones() == ones && index.Zeros() == size - ones);
+            if (size >= 100000) {
+                // CS-Poppy stores 64 bits per 2048 plus sparse samples
+                assert(index.IndexBytes() * 100 < size / 8 * 5);
+            }
+        }
+    }
+    {
+        BitVector bits(5000);
+        RankSelect index(bits);
+        assert(index.Ones() == 0);
+        bits.Set(4321);
+        index.Invalidate();
+        assert(index.Ones() == 1 && index.Select1(0) == 4321 && index.Rank1(4322) == 1);
+    }
+}
+
+void CheckPackedDecode(const PackedIntVector& packed, const Vector<uint32_t>& expected) {
+    for (SimdLevel level : {SimdLevel::kScalar, SimdLevel::kAvx2}) {
+        Simd::SetLevel(level);
+        Vector<uint32_t> decoded;
+        packed.Decode(decoded);
+        assert(decoded.Size() == expected.Size());
+        assert(std::equal(decoded.begin(), decoded.end(), expected.begin()));
+        for (size_t first = 0; first < 9 && first < expected.Size(); ++first) {
+            const size_t count = (expected.Size() - first) / 3;
+            uint32_t part[1024];
+            packed.Decode(first, std::min<size_t>(count, 1024), part);
+            assert(std::equal(part, part + std::min<size_t>(count, 1024), expected.begin() + first));
+        }
+    }
+    Simd::SetLevel(Simd::SupportedLevel());
+}
+
+void Test29() {
+    std::mt19937_64 random(29);
+    for (size_t width : {0, 1, 7, 13, 20, 31, 32}) {
+        const uint32_t base = width == 32 ? 0 : 1000;
+        Vector<uint32_t> values;
+        for (size_t i = 0; i < 5000; ++i) {
+            const uint64_t mask = width == 0 ? 0 : (uint64_t{1} << width) - 1;
+            values.PushBack(static_cast<uint32_t>(base + (random() & mask)));
+        }
+        const PackedIntVector packed(values.begin(), values.Size());
+        assert(packed.Size() == values.Size() && packed.Width() <= width);
+        assert(packed.MemoryBytes() <= (values.Size() * width + 127) / 8 + 8);
+        for (size_t i = 0; i < values.Size(); ++i) {
+            assert(packed[i] == values[i]);
+        }
+        CheckPackedDecode(packed, values);
+    }
+    {
+        // Width grows with the values and the base follows smaller ones
+        PackedIntVector packed;
+        Vector<uint32_t> values;
+        for (uint32_t i = 0; i < 3000; ++i) {
+            const uint32_t value = 1000000 - i * i / 16;
+            packed.PushBack(value);
+            values.PushBack(value);
+        }
+        for (uint32_t i = 0; i < 3000; ++i) {
+            packed.PushBack(i << 10);
+            values.PushBack(i << 10);
+        }
+        assert(packed.Width() <= 22);
+        packed.Set(17, 5);
+        values[17] = 5;
+        packed.Set(18, uint32_t(-1));
+        values[18] = uint32_t(-1);
+        for (size_t i = 0; i < values.Size(); ++i) {
+            assert(packed[i] == values[i]);
+        }
+        CheckPackedDecode(packed, values);
+
+        PackedIntVector copy = packed;
+        packed.PushBack(uint64_t(-1));
+        assert(packed.Width() == 64 && packed[packed.Size() - 1] == uint64_t(-1) && packed[18] == uint32_t(-1));
+        assert(copy.Size() == values.Size() && copy[17] == 5);
+    }
+}
+
+void Test30() {
+    std::mt19937_64 random(30);
+    Vector<uint64_t> ids;
+    uint64_t id = 1000;
+    for (size_t i = 0; i < 10000; ++i) {
+        // Mostly small gaps, some duplicates and a few large jumps
+        const uint64_t kind = random() % 100;
+        id += kind < 10 ? 0 : kind < 98 ? random() % 200 : random() % (uint64_t{1} << 40);
+        ids.PushBack(id);
+    }
+    const SortedDeltaVector sorted(ids);
+    assert(sorted.Size() == ids.Size() && sorted.Back() == ids[ids.Size() - 1]);
+    assert(sorted.MemoryBytes() * 3 < ids.Size() * sizeof(uint64_t));
+    assert(std::equal(sorted.begin(), sorted.end(), ids.begin()));
+    {
+        // *it++ dereferences a temporary iterator, so it must not return a
+        // reference into it
+        auto it = sorted.begin();
+        const uint64_t& first = *it++;
+        assert(first == ids[0] && *it == ids[1]);
+    }
+    for (size_t i = 0; i < ids.Size(); i += 97) {
+        assert(sorted[i] == ids[i]);
+    }
+    Vector<uint64_t> decoded;
+    sorted.Decode(decoded);
+    assert(decoded.Size() == ids.Size() && std::equal(decoded.begin(), decoded.end(), ids.begin()));
+
+    for (size_t i = 0; i < 2000; ++i) {
+        const uint64_t probe = i < 1000 ? ids[random() % ids.Size()] + random() % 3 - 1 : random() % (id + 10);
+        const auto expected = std::lower_bound(ids.begin(), ids.end(), probe);
+        const auto it = sorted.LowerBound(probe);
+        assert(it.Index() == size_t(expected - ids.begin()));
+        assert(it == sorted.end() || *it == *expected);
+        assert(sorted.Contains(probe) == (expected != ids.end() && *expected == probe));
+    }
+    assert(sorted.LowerBound(0) == sorted.begin() && sorted.LowerBound(id + 1) == sorted.end());
+
+    SortedDeltaVector copy = sorted;
+    copy.PushBack(id);
+    copy.PushBack(id + 300);
+    assert(copy.Size() == sorted.Size() + 2 && copy[copy.Size() - 1] == id + 300);
+    assert(copy.LowerBound(id + 1).Index() == copy.Size() - 1);
+
+    const SortedDeltaVector empty;
+    assert(empty.begin() == empty.end() && empty.LowerBound(5) == empty.end() && !empty.Contains(0));
+}
+
+enum class Status { kActive, kSuspended, kClosed };
+
+void Test31() {
+    {
+        const std::string countries[] = {"DE", "FR", "JP", "US", "BR"};
+        Vector<std::string> values;
+        std::mt19937 random(31);
+        for (size_t i = 0; i < 3000; ++i) {
+            values.PushBack(countries[random() % 5]);
+        }
+        DictVector<std::string> dict(values);
+        assert(dict.Size() == values.Size() && dict.Dictionary().Size() == 5 && dict.CodeBytes() == 1);
+        for (size_t i = 0; i < values.Size(); ++i) {
+            assert(dict[i] == values[i]);
+        }
+        const BitVector french = dict.Equal("FR");
+        assert(french.Size() == values.Size());
+        assert(french.Count() == size_t(std::count(values.begin(), values.end(), "FR")));
+        for (size_t i : french.SetBits()) {
+            assert(values[i] == "FR");
+        }
+        assert(dict.NotEqual("FR") == ~french);
+        assert(dict.Equal("IT").Count() == 0 && dict.NotEqual("IT").Count() == values.Size());
+        assert(dict.Find("IT") == DictVector<std::string>::kNoCode);
+
+        dict.Set(7, "IT");
+        values[7] = "IT";
+        dict.PushBack("JP");
+        values.PushBack("JP");
+        Vector<std::string> decoded;
+        dict.Decode(decoded);
+        assert(decoded.Size() == values.Size() && std::equal(decoded.begin(), decoded.end(), values.begin()));
+        assert(dict.Equal("IT").FindFirst() == 7);
+    }
+    {
+        DictVector<Status> statuses;
+        for (int i = 0; i < 100; ++i) {
+            statuses.PushBack(i % 10 == 0 ? Status::kClosed : Status::kActive);
+        }
+        assert(statuses.Equal(Status::kClosed).Count() == 10);
+        assert(statuses.Equal(Status::kSuspended).Count() == 0);
+        assert(statuses[10] == Status::kClosed && statuses.Code(1) == 1);
+    }
+    {
+        // Codes widen from 8 to 16 to 32 bits as the dictionary grows
+        DictVector<uint32_t> dict;
+        for (uint32_t i = 0; i < 100000; ++i) {
+            dict.PushBack(i % 3 == 0 ? 7 : i);
+            if (i == 200) {
+                assert(dict.CodeBytes() == 1);
+            } else if (i == 1000) {
+                assert(dict.CodeBytes() == 2);
+            }
+        }
+        assert(dict.CodeBytes() == 4 && dict.Size() == 100000);
+        for (uint32_t i = 0; i < 100000; i += 7) {
+            assert(dict[i] == (i % 3 == 0 ? 7 : i));
+        }
+        // Every third element, and element 7 itself
+        assert(dict.Equal(7).Count() == 33334 + 1);
+    }
+}
+
+struct C {
+    C() noexcept {
+        ++def_ctor;
+    }
+    C(const C& /*other*/) noexcept {
+        ++copy_ctor;
+    }
+    C(C&& /*other*/) noexcept {
+        ++move_ctor;
+    }
+    C& operator=(const C& other) noexcept {
+        if (this != &other) {
+            ++copy_assign;
+        }
+        return *this;
+    }
+    C& operator=(C&& /*other*/) noexcept {
+        ++move_assign;
+        return *this;
+    }
+    ~C() {
+        ++dtor;
+    }
+
+    static void Reset() {
+        def_ctor = 0;
+        copy_ctor = 0;
+        move_ctor = 0;
+        copy_assign = 0;
+        move_assign = 0;
+        dtor = 0;
+    }
+
+    inline static size_t def_ctor = 0;
+    inline static size_t copy_ctor = 0;
+    inline static size_t move_ctor = 0;
+    inline static size_t copy_assign = 0;
+    inline static size_t move_assign = 0;
+    inline static size_t dtor = 0;
+};
+
+void Dump() {
+    using namespace std;
+    cerr << "Def ctors: "sv << C::def_ctor              //
+         << ", Copy ctors: "sv << C::copy_ctor          //
+         << ", Move ctors: "sv << C::move_ctor          //
+         << ", Copy assignments: "sv << C::copy_assign  //
+         << ", Move assignments: "sv << C::move_assign  //
+         << ", Dtors: "sv << C::dtor << endl;
+}
+
+void Benchmark() {
+    using namespace std;
+    try {
+        const size_t NUM = 10;
+        C c;
+        {
+            cerr << "std::vector:"sv << endl;
+            C::Reset();
+            vector<C> v(NUM);
+            Dump();
+            v.push_back(c);
+        }
+        Dump();
+    } catch (...) {
+    }
+    try {
+        const size_t NUM = 10;
+        C c;
+        {
+            cerr << "Vector:"sv << endl;
+            C::Reset();
+            Vector<C> v(NUM);
+            Dump();
+            v.PushBack(c);
+        }
+        Dump();
+    } catch (...) {
+    }
+}
+
+void BenchmarkParallel() {
+    using namespace std;
+    Vector<double> values(size_t{1} << 22);
+    for (size_t i = 0; i < values.Size(); ++i) {
+        values[i] = static_cast<double>(i);
+    }
+    const size_t max_threads = max<size_t>(4, ThreadPool::DefaultThreadCount());
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        ThreadPool pool(threads);
+        const ParallelOptions options{0, &pool};
+        const auto start = chrono::steady_clock::now();
+        ParallelForEach(values, [](double& x) { x = sqrt(x); }, options);
+        const double sum = ParallelReduce(values, 0.0, plus<>(), options);
+        ParallelTransform(values, values, [](double x) { return x * x; }, options);
+        const auto elapsed = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start);
+        cerr << "Parallel, "sv << threads << " threads: "sv << elapsed.count() << " us (sum "sv << sum << ")"sv << endl;
+    }
+}
+
+void BenchmarkRankSelect() {
+    using namespace std;
+    const size_t kBits = size_t{1} << 26;
+    const size_t kQueries = 1 << 20;
+    const size_t kScans = 64;
+    mt19937_64 random(1);
+    BitVector bits(kBits);
+    for (size_t i = 0; i < kBits; ++i) {
+        bits[i] = random() % 4 == 0;
+    }
+    RankSelect index(bits);
+    index.Build();
+    Vector<size_t> positions(kQueries);
+    for (size_t& pos : positions) {
+        pos = random() % kBits;
+    }
+    auto time_per_query = [](size_t queries, auto&& run) {
+        const auto start = chrono::steady_clock::now();
+        run();
+        return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / queries;
+    };
+
+    size_t checksum = 0;
+    const double rank = time_per_query(kQueries, [&] {
+        for (size_t pos : positions) {
+            checksum += index.Rank1(pos);
+        }
+    });
+    // Without an index, rank is a popcount over the words before `pos`
+    const double rank_scan = time_per_query(kScans, [&] {
+        for (size_t i = 0; i < kScans; ++i) {
+            const size_t pos = positions[i] / 64 * 64;
+            checksum += Simd::PopCount(bits.Words(), pos / 64);
+        }
+    });
+    const double select = time_per_query(kQueries, [&] {
+        for (size_t pos : positions) {
+            checksum += index.Select1(pos % index.Ones());
+        }
+    });
+    const double select_scan = time_per_query(kScans, [&] {
+        for (size_t i = 0; i < kScans; ++i) {
+            size_t rank = positions[i] % index.Ones();
+            size_t word = 0;
+            for (size_t count; rank >= (count = __builtin_popcountll(bits.Words()[word])); ++word) {
+                rank -= count;
+            }
+            checksum += word;
+        }
+    });
+    cerr << "RankSelect: rank "sv << rank << " ns (scan "sv << rank_scan << " ns), select "sv << select
+         << " ns (scan "sv << select_scan << " ns), index "sv << 100.0 * index.IndexBytes() / (kBits / 8)
+         << "% of bits, checksum "sv << checksum << endl;
 }
 
 int main() {
@@ -642,7 +2617,34 @@ int main() {
         Test4();
         Test5();
         Test6();
+        Test7();
+        Test8();
+        Test9();
+        Test10();
+        Test11();
+        Test12();
+        Test13();
+        Test14();
+        Test15();
+        Test16();
+        Test17();
+        Test18();
+        Test19();
+        Test20();
+        Test21();
+        Test22();
+        Test23();
+        Test24();
+        Test25();
+        Test26();
+        Test27();
+        Test28();
+        Test29();
+        Test30();
+        Test31();
         Benchmark();
+        BenchmarkParallel();
+        BenchmarkRankSelect();
     } catch (const std::exception& e) {
         std::cerr << e.what() << std::endl;
     }
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// MallocAllocator obtains buffers from malloc for mid-sized requests and from
+// anonymous mmap for large ones, and implements the `reallocate` hook so that
+// RawMemory::TryReallocate can grow a buffer of trivially relocatable
+// elements without an explicit copy: realloc may extend the heap block in
+// place, and mremap(MREMAP_MAYMOVE) moves large buffers by remapping pages.
+template <typename T>
+class MallocAllocator {
+    static_assert(alignof(T) <= alignof(std::max_align_t), "MallocAllocator does not support over-aligned types");
+
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    // Buffers of at least this many bytes are page-mapped
+    static constexpr size_t kMapThreshold = size_t{1} << 20;
+
+    MallocAllocator() noexcept = default;
+
+    template <typename U>
+    MallocAllocator(const MallocAllocator<U>& /*other*/) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > size_t(-1) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        void* ptr = AllocateBytes(n * sizeof(T));
+        if (ptr == nullptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        DeallocateBytes(p, n * sizeof(T));
+    }
+
+    // Resizes the block at `p`, moving its bytes if needed.
+    // Returns nullptr (leaving `p` intact) on failure.
+    T* reallocate(T* p, size_t old_n, size_t new_n) noexcept {
+        if (new_n == 0 || new_n > size_t(-1) / sizeof(T)) {
+            return nullptr;
+        }
+        return static_cast<T*>(ReallocateBytes(p, old_n * sizeof(T), new_n * sizeof(T)));
+    }
+
+    template <typename U>
+    bool operator==(const MallocAllocator<U>& /*other*/) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const MallocAllocator<U>& /*other*/) const noexcept {
+        return false;
+    }
+
+private:
+    static bool IsMapped(size_t bytes) noexcept;
+    static size_t PageRound(size_t bytes) noexcept;
+    static void* AllocateBytes(size_t bytes) noexcept;
+    static void DeallocateBytes(void* ptr, size_t bytes) noexcept;
+    static void* ReallocateBytes(void* ptr, size_t old_bytes, size_t new_bytes) noexcept;
+};
+
+
+// Implementation of MallocAllocator class template methods
+
+
+template <typename T>
+bool MallocAllocator<T>::IsMapped(size_t bytes) noexcept {
+#if defined(__linux__)
+    return bytes >= kMapThreshold;
+#else
+    (void)bytes;
+    return false;
+#endif
+}
+
+template <typename T>
+size_t MallocAllocator<T>::PageRound(size_t bytes) noexcept {
+#if defined(__linux__)
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return (bytes + page_size - 1) / page_size * page_size;
+#else
+    return bytes;
+#endif
+}
+
+template <typename T>
+void* MallocAllocator<T>::AllocateBytes(size_t bytes) noexcept {
+#if defined(__linux__)
+    if (IsMapped(bytes)) {
+        void* ptr = mmap(nullptr, PageRound(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return ptr == MAP_FAILED ? nullptr : ptr;
+    }
+#endif
+    return std::malloc(bytes);
+}
+
+template <typename T>
+void MallocAllocator<T>::DeallocateBytes(void* ptr, size_t bytes) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+#if defined(__linux__)
+    if (IsMapped(bytes)) {
+        munmap(ptr, PageRound(bytes));
+        return;
+    }
+#endif
+    std::free(ptr);
+}
+
+template <typename T>
+void* MallocAllocator<T>::ReallocateBytes(void* ptr, size_t old_bytes, size_t new_bytes) noexcept {
+    const bool old_mapped = IsMapped(old_bytes);
+    const bool new_mapped = IsMapped(new_bytes);
+#if defined(__linux__)
+    if (old_mapped && new_mapped) {
+        void* result = mremap(ptr, PageRound(old_bytes), PageRound(new_bytes), MREMAP_MAYMOVE);
+        return result == MAP_FAILED ? nullptr : result;
+    }
+#endif
+    if (!old_mapped && !new_mapped) {
+        return std::realloc(ptr, new_bytes);
+    }
+    // Crossing the threshold changes the kind of block, so copy once
+    void* result = AllocateBytes(new_bytes);
+    if (result != nullptr) {
+        std::memcpy(result, ptr, old_bytes < new_bytes ? old_bytes : new_bytes);
+        DeallocateBytes(ptr, old_bytes);
+    }
+    return result;
+}
@@ -0,0 +1,381 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "vector.h"
+
+// MappedFile is the file behind a MappedFileAllocator. The file starts with
+// a one-page header recording the element size and the number of elements
+// stored at the last Flush; the elements follow, page-aligned, so they can
+// be mapped in place. At most one mapping of the data area is live at a
+// time. POSIX only.
+class MappedFile {
+public:
+    // Opens or creates `path` for elements of `element_size` bytes.
+    // Throws std::system_error on I/O errors and std::runtime_error if the
+    // file holds elements of another size.
+    static std::shared_ptr<MappedFile> Open(const std::string& path, size_t element_size);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Number of elements recorded by the last Flush
+    size_t StoredSize() const noexcept { return header_.size; }
+
+    // True while Map has returned a range that is not unmapped yet
+    bool IsMapped() const noexcept { return mapped_ != nullptr; }
+    // True if `data` is the live mapping
+    bool Owns(const void* data) const noexcept { return data != nullptr && data == mapped_; }
+
+    // Maps the first `bytes` of the data area, growing the file if needed.
+    // The data area must not be mapped already.
+    void* Map(size_t bytes);
+    void Unmap(void* data, size_t bytes) noexcept;
+    // Grows or shrinks the live mapping; returns nullptr on failure
+    void* Remap(void* data, size_t old_bytes, size_t new_bytes) noexcept;
+
+    // Writes `size` elements at `data` and the header to disk. `data` is
+    // either the live mapping or memory outside the file, which is copied in.
+    void Flush(const void* data, size_t size);
+
+    static size_t PageRound(size_t bytes) noexcept;
+
+    ~MappedFile();
+
+private:
+    struct Header {
+        uint64_t magic;
+        uint64_t element_size;
+        uint64_t size;
+        uint64_t data_offset;
+    };
+
+    static constexpr uint64_t kMagic = 0x3130564550414d56;  // "VMAPEV01"
+
+    MappedFile(int fd, const Header& header) noexcept
+        : fd_(fd), header_(header) {}
+
+    // Extends the file so that it holds `bytes` of data
+    bool Reserve(size_t bytes) noexcept;
+
+    int fd_;
+    Header header_;
+    void* mapped_ = nullptr;
+};
+
+// MappedFileAllocator maps its buffer from a MappedFile with MAP_SHARED, so
+// a Vector's elements are the file's contents: opening a stored vector
+// costs one mmap, and growth extends the file and remaps it with mremap.
+//
+// Only one buffer maps the file at a time. A buffer allocated while the file
+// is mapped, such as a temporary of Insert or the target of a relocation,
+// gets anonymous memory, so buffers never share pages. A vector relocated
+// into anonymous memory moves back into the file when it next grows through
+// `reallocate`, and Flush copies it into the file meanwhile.
+//
+// An allocator without a file, such as the one a copied vector gets from
+// select_on_container_copy_construction, uses anonymous memory instead.
+//
+// The allocator never propagates, so a vector stays with its own file:
+// assigning one mapped vector to another copies or moves the elements into
+// the target's file (or anonymous memory), and Swap requires both vectors to
+// use the same file.
+template <typename T>
+class MappedFileAllocator {
+    static_assert(std::is_trivially_copyable_v<T>, "Mapped elements are stored as raw bytes");
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+
+    MappedFileAllocator() noexcept = default;
+    explicit MappedFileAllocator(std::shared_ptr<MappedFile> file) noexcept
+        : file_(std::move(file)) {}
+
+    template <typename U>
+    MappedFileAllocator(const MappedFileAllocator<U>& other) noexcept
+        : file_(other.file_) {}
+
+    T* allocate(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+
+    // Resizes the mapping at `p`, moving it if needed. Returns nullptr
+    // (leaving `p` intact) on failure.
+    T* reallocate(T* p, size_t old_n, size_t new_n) noexcept;
+
+    // Copies of a mapped vector live in memory rather than in the same file
+    MappedFileAllocator select_on_container_copy_construction() const noexcept {
+        return MappedFileAllocator();
+    }
+
+    const std::shared_ptr<MappedFile>& File() const noexcept { return file_; }
+
+    template <typename U>
+    bool operator==(const MappedFileAllocator<U>& other) const noexcept {
+        return file_ == other.file_;
+    }
+
+    template <typename U>
+    bool operator!=(const MappedFileAllocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    template <typename U>
+    friend class MappedFileAllocator;
+
+    static T* AllocateAnonymous(size_t n);
+    static T* ReallocateAnonymous(T* p, size_t old_n, size_t new_n) noexcept;
+
+    std::shared_ptr<MappedFile> file_;
+};
+
+template <typename T>
+using MappedVector = Vector<T, MappedFileAllocator<T>>;
+
+// Opens the vector stored in `path`, creating an empty one if the file does
+// not exist. The stored elements are mapped, not read.
+template <typename T>
+MappedVector<T> OpenMappedVector(const std::string& path);
+
+// Writes the elements of a mapped vector to disk (msync) and records its
+// size, so that OpenMappedVector finds them. Does nothing for vectors that
+// are not backed by a file.
+template <typename T, typename Growth>
+void Flush(Vector<T, MappedFileAllocator<T>, Growth>& vec);
+
+
+// Implementation of MappedFile class methods
+
+
+inline std::shared_ptr<MappedFile> MappedFile::Open(const std::string& path, size_t element_size) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    auto fail = [fd, &path](const char* what) {
+        const int error = errno;
+        ::close(fd);
+        throw std::system_error(error, std::generic_category(), what + (" " + path));
+    };
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        fail("fstat");
+    }
+    Header header{kMagic, element_size, 0, PageRound(sizeof(Header))};
+    if (st.st_size == 0) {
+        if (::pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+            || ::ftruncate(fd, static_cast<off_t>(header.data_offset)) != 0) {
+            fail("initialize");
+        }
+    } else {
+        if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            fail("read header of");
+        }
+        if (header.magic != kMagic || header.element_size != element_size
+            || header.data_offset % PageRound(1) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Incompatible mapped vector file " + path);
+        }
+    }
+    return std::shared_ptr<MappedFile>(new MappedFile(fd, header));
+}
+
+inline void* MappedFile::Map(size_t bytes) {
+    assert(!IsMapped());
+    if (!Reserve(bytes)) {
+        throw std::bad_alloc();
+    }
+    void* data = ::mmap(nullptr, PageRound(bytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                        static_cast<off_t>(header_.data_offset));
+    if (data == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    mapped_ = data;
+    return data;
+}
+
+inline void MappedFile::Unmap(void* data, size_t bytes) noexcept {
+    assert(Owns(data));
+    ::munmap(data, PageRound(bytes));
+    mapped_ = nullptr;
+}
+
+inline void* MappedFile::Remap(void* data, size_t old_bytes, size_t new_bytes) noexcept {
+    assert(Owns(data));
+    if (!Reserve(new_bytes)) {
+        return nullptr;
+    }
+#if defined(__linux__)
+    void* result = ::mremap(data, PageRound(old_bytes), PageRound(new_bytes), MREMAP_MAYMOVE);
+    if (result == MAP_FAILED) {
+        return nullptr;
+    }
+#else
+    // The contents live in the file, so a fresh mapping of the larger range
+    // sees them without copying
+    void* result = ::mmap(nullptr, PageRound(new_bytes), PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                          static_cast<off_t>(header_.data_offset));
+    if (result == MAP_FAILED) {
+        return nullptr;
+    }
+    ::munmap(data, PageRound(old_bytes));
+#endif
+    mapped_ = result;
+    return result;
+}
+
+inline void MappedFile::Flush(const void* data, size_t size) {
+    const size_t bytes = size * header_.element_size;
+    if (bytes != 0 && Owns(data)) {
+        if (::msync(const_cast<void*>(data), PageRound(bytes), MS_SYNC) != 0) {
+            throw std::system_error(errno, std::generic_category(), "msync");
+        }
+    } else if (bytes != 0) {
+        if (!Reserve(bytes)) {
+            throw std::system_error(errno, std::generic_category(), "ftruncate");
+        }
+        const auto* bytes_in = static_cast<const char*>(data);
+        for (size_t written = 0; written < bytes;) {
+            const ssize_t result = ::pwrite(fd_, bytes_in + written, bytes - written,
+                                            static_cast<off_t>(header_.data_offset + written));
+            if (result < 0) {
+                throw std::system_error(errno, std::generic_category(), "write elements");
+            }
+            written += static_cast<size_t>(result);
+        }
+    }
+    header_.size = size;
+    if (::pwrite(fd_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_)) || ::fsync(fd_) != 0) {
+        throw std::system_error(errno, std::generic_category(), "write header");
+    }
+}
+
+inline MappedFile::~MappedFile() {
+    ::close(fd_);
+}
+
+inline size_t MappedFile::PageRound(size_t bytes) noexcept {
+    static const size_t page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return (bytes + page_size - 1) / page_size * page_size;
+}
+
+inline bool MappedFile::Reserve(size_t bytes) noexcept {
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) {
+        return false;
+    }
+    // Whole pages, so that every mapped page is backed by the file
+    const off_t required = static_cast<off_t>(header_.data_offset + PageRound(bytes));
+    return st.st_size >= required || ::ftruncate(fd_, required) == 0;
+}
+
+
+// Implementation of MappedFileAllocator class template methods
+
+
+template <typename T>
+T* MappedFileAllocator<T>::allocate(size_t n) {
+    if (n > size_t(-1) / 2 / sizeof(T)) {
+        throw std::bad_array_new_length();
+    }
+    if (file_ == nullptr || file_->IsMapped()) {
+        return AllocateAnonymous(n);
+    }
+    return static_cast<T*>(file_->Map(n * sizeof(T)));
+}
+
+template <typename T>
+void MappedFileAllocator<T>::deallocate(T* p, size_t n) noexcept {
+    if (file_ != nullptr && file_->Owns(p)) {
+        file_->Unmap(p, n * sizeof(T));
+    } else {
+        ::munmap(p, MappedFile::PageRound(n * sizeof(T)));
+    }
+}
+
+template <typename T>
+T* MappedFileAllocator<T>::reallocate(T* p, size_t old_n, size_t new_n) noexcept {
+    if (new_n == 0 || new_n > size_t(-1) / 2 / sizeof(T)) {
+        return nullptr;
+    }
+    if (file_ != nullptr && file_->Owns(p)) {
+        return static_cast<T*>(file_->Remap(p, old_n * sizeof(T), new_n * sizeof(T)));
+    }
+    if (file_ != nullptr && !file_->IsMapped()) {
+        // Moves an anonymous buffer back into the file
+        T* mapped = nullptr;
+        try {
+            mapped = static_cast<T*>(file_->Map(new_n * sizeof(T)));
+        } catch (...) {
+            return nullptr;
+        }
+        std::memcpy(static_cast<void*>(mapped), p, std::min(old_n, new_n) * sizeof(T));
+        ::munmap(p, MappedFile::PageRound(old_n * sizeof(T)));
+        return mapped;
+    }
+    return ReallocateAnonymous(p, old_n, new_n);
+}
+
+template <typename T>
+T* MappedFileAllocator<T>::AllocateAnonymous(size_t n) {
+    void* data = ::mmap(nullptr, MappedFile::PageRound(n * sizeof(T)), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(data);
+}
+
+template <typename T>
+T* MappedFileAllocator<T>::ReallocateAnonymous(T* p, size_t old_n, size_t new_n) noexcept {
+#if defined(__linux__)
+    void* result = ::mremap(p, MappedFile::PageRound(old_n * sizeof(T)), MappedFile::PageRound(new_n * sizeof(T)),
+                            MREMAP_MAYMOVE);
+    return result == MAP_FAILED ? nullptr : static_cast<T*>(result);
+#else
+    (void)p;
+    (void)old_n;
+    (void)new_n;
+    return nullptr;
+#endif
+}
+
+
+// Implementation of mapped vector functions
+
+
+template <typename T>
+MappedVector<T> OpenMappedVector(const std::string& path) {
+    auto file = MappedFile::Open(path, sizeof(T));
+    const size_t stored = file->StoredSize();
+    MappedVector<T> vec{MappedFileAllocator<T>(std::move(file))};
+    // Default initialization leaves the mapped bytes as they are
+    vec.ResizeDefaultInit(stored);
+    return vec;
+}
+
+template <typename T, typename Growth>
+void Flush(Vector<T, MappedFileAllocator<T>, Growth>& vec) {
+    const MappedFileAllocator<T> alloc = vec.GetAllocator();
+    if (alloc.File() != nullptr) {
+        alloc.File()->Flush(vec.begin(), vec.Size());
+    }
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "growth_policy.h"
+#include "raw_memory.h"
+#include "simd_kernels.h"
+#include "vector.h"
+
+#if VECTOR_SIMD_X86
+#include <immintrin.h>
+#endif
+
+// PackedIntVector stores unsigned integers with frame-of-reference bit
+// packing: each value is kept as its offset from a common base, in a fixed
+// number of bits just wide enough for the largest offset. Values are laid
+// out back to back in 64-bit words, so element i starts at bit i * Width().
+//
+// PushBack and Set re-encode the vector when a value does not fit: with a
+// wider width if it is too large, or with a lower base if it is below the
+// current one. The base is lowered by at least twice the shortfall, so a
+// descending sequence re-encodes O(log range) times rather than per element.
+//
+// Decode unpacks a range into uint32_t; on x86-64 with AVX2 it extracts
+// four values per step with a gather and variable shifts.
+class PackedIntVector {
+public:
+    PackedIntVector() = default;
+
+    // Packs `size` values with the base and width that fit them exactly
+    template <typename T>
+    PackedIntVector(const T* values, size_t size);
+
+    PackedIntVector(const PackedIntVector& other);
+    PackedIntVector(PackedIntVector&& other) noexcept;
+
+    PackedIntVector& operator=(const PackedIntVector& rhs);
+    PackedIntVector& operator=(PackedIntVector&& rhs) noexcept;
+
+    void Swap(PackedIntVector& other) noexcept;
+
+    void Reserve(size_t new_capacity);
+
+    void PushBack(uint64_t value);
+    void Set(size_t index, uint64_t value);
+
+    uint64_t operator[](size_t index) const noexcept;
+
+    // Writes elements [first, first + count) to `out`. Every value must fit
+    // in 32 bits.
+    void Decode(size_t first, size_t count, uint32_t* out) const;
+
+    // Replaces the contents of `out` with all elements
+    template <typename A, typename G>
+    void Decode(Vector<uint32_t, A, G>& out) const;
+
+    size_t Size() const noexcept { return size_; }
+    size_t Capacity() const noexcept { return capacity_; }
+    uint64_t Base() const noexcept { return base_; }
+    size_t Width() const noexcept { return width_; }
+
+    // Memory taken by the packed words
+    size_t MemoryBytes() const noexcept { return words_.Capacity() * sizeof(uint64_t); }
+
+    // Number of bits needed to store `value`
+    static size_t BitWidth(uint64_t value) noexcept { return value == 0 ? 0 : 64 - __builtin_clzll(value); }
+
+private:
+    static constexpr size_t kWordBits = 64;
+
+    RawMemory<uint64_t> words_;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+    uint64_t base_ = 0;
+    size_t width_ = 0;
+
+    uint64_t Mask() const noexcept { return width_ == kWordBits ? ~uint64_t{0} : (uint64_t{1} << width_) - 1; }
+    bool Fits(uint64_t value) const noexcept { return value >= base_ && ((value - base_) & ~Mask()) == 0; }
+
+    // Words for `capacity` elements of `width` bits, plus one so that an
+    // unaligned 64-bit load at any element's first byte stays in bounds
+    static size_t WordsFor(size_t capacity, size_t width) noexcept {
+        return (capacity * width + kWordBits - 1) / kWordBits + 1;
+    }
+
+    uint64_t Load(size_t index) const noexcept;
+    void Store(size_t index, uint64_t delta) noexcept;
+
+    // Re-encodes the elements into a new buffer
+    void Reencode(size_t capacity, uint64_t base, size_t width);
+
+    // Re-encodes with a base and width that also fit `value`
+    void Widen(uint64_t value);
+
+    static void DecodeScalar(const PackedIntVector& vec, size_t first, size_t count, uint32_t* out) noexcept;
+#if VECTOR_SIMD_X86
+    static void DecodeAvx2(const PackedIntVector& vec, size_t first, size_t count, uint32_t* out) noexcept;
+#endif
+};
+
+
+// Implementation of PackedIntVector class methods
+
+
+template <typename T>
+PackedIntVector::PackedIntVector(const T* values, size_t size) {
+    static_assert(std::is_unsigned_v<T>, "PackedIntVector stores unsigned integers");
+    if (size == 0) {
+        return;
+    }
+    const auto [min, max] = std::minmax_element(values, values + size);
+    Reencode(size, *min, BitWidth(*max - *min));
+    for (size_t i = 0; i < size; ++i) {
+        Store(i, values[i] - base_);
+    }
+    size_ = size;
+}
+
+inline PackedIntVector::PackedIntVector(const PackedIntVector& other)
+    : words_(other.words_.Capacity())
+    , size_(other.size_)
+    , capacity_(other.capacity_)
+    , base_(other.base_)
+    , width_(other.width_) {
+    if (words_.Capacity() != 0) {
+        std::memcpy(words_.GetAddress(), other.words_.GetAddress(), words_.Capacity() * sizeof(uint64_t));
+    }
+}
+
+inline PackedIntVector::PackedIntVector(PackedIntVector&& other) noexcept
+    : words_(std::move(other.words_))
+    , size_(std::exchange(other.size_, 0))
+    , capacity_(std::exchange(other.capacity_, 0))
+    , base_(std::exchange(other.base_, 0))
+    , width_(std::exchange(other.width_, 0)) {
+}
+
+inline PackedIntVector& PackedIntVector::operator=(const PackedIntVector& rhs) {
+    if (this != &rhs) {
+        PackedIntVector copy(rhs);
+        Swap(copy);
+    }
+    return *this;
+}
+
+inline PackedIntVector& PackedIntVector::operator=(PackedIntVector&& rhs) noexcept {
+    if (this != &rhs) {
+        PackedIntVector moved(std::move(rhs));
+        Swap(moved);
+    }
+    return *this;
+}
+
+inline void PackedIntVector::Swap(PackedIntVector& other) noexcept {
+    words_.Swap(other.words_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(base_, other.base_);
+    std::swap(width_, other.width_);
+}
+
+inline void PackedIntVector::Reserve(size_t new_capacity) {
+    if (new_capacity > capacity_) {
+        Reencode(new_capacity, base_, width_);
+    }
+}
+
+inline void PackedIntVector::PushBack(uint64_t value) {
+    if (size_ == 0) {
+        // Nothing to re-encode: the first value becomes the base
+        base_ = value;
+    } else if (!Fits(value)) {
+        Widen(value);
+    }
+    if (size_ == capacity_) {
+        Reencode(std::max(size_ + 1, DefaultGrowth::Grow<uint64_t>(capacity_, size_ + 1)), base_, width_);
+    }
+    Store(size_, value - base_);
+    ++size_;
+}
+
+inline void PackedIntVector::Set(size_t index, uint64_t value) {
+    assert(index < size_);
+    if (!Fits(value)) {
+        Widen(value);
+    }
+    Store(index, value - base_);
+}
+
+inline uint64_t PackedIntVector::operator[](size_t index) const noexcept {
+    assert(index < size_);
+    return base_ + Load(index);
+}
+
+inline void PackedIntVector::Decode(size_t first, size_t count, uint32_t* out) const {
+    assert(first + count <= size_);
+    assert(width_ <= 32 && base_ <= UINT32_MAX);
+#if VECTOR_SIMD_X86
+    if (Simd::ActiveLevel() >= SimdLevel::kAvx2) {
+        DecodeAvx2(*this, first, count, out);
+        return;
+    }
+#endif
+    DecodeScalar(*this, first, count, out);
+}
+
+template <typename A, typename G>
+void PackedIntVector::Decode(Vector<uint32_t, A, G>& out) const {
+    out.Resize(0);
+    Decode(0, size_, out.AppendUninitialized(size_));
+}
+
+inline uint64_t PackedIntVector::Load(size_t index) const noexcept {
+    const size_t bit = index * width_;
+    const size_t word = bit / kWordBits;
+    const size_t offset = bit % kWordBits;
+    uint64_t value = words_[word] >> offset;
+    if (offset + width_ > kWordBits) {
+        value |= words_[word + 1] << (kWordBits - offset);
+    }
+    return value & Mask();
+}
+
+inline void PackedIntVector::Store(size_t index, uint64_t delta) noexcept {
+    if (width_ == 0) {
+        return;
+    }
+    const size_t bit = index * width_;
+    const size_t word = bit / kWordBits;
+    const size_t offset = bit % kWordBits;
+    const uint64_t mask = Mask();
+    words_[word] = (words_[word] & ~(mask << offset)) | (delta << offset);
+    if (offset + width_ > kWordBits) {
+        const size_t shift = kWordBits - offset;
+        words_[word + 1] = (words_[word + 1] & ~(mask >> shift)) | (delta >> shift);
+    }
+}
+
+inline void PackedIntVector::Reencode(size_t capacity, uint64_t base, size_t width) {
+    assert(capacity >= size_);
+    PackedIntVector fresh;
+    fresh.words_ = RawMemory<uint64_t>(WordsFor(capacity, width));
+    std::fill(fresh.words_ + 0, fresh.words_ + fresh.words_.Capacity(), uint64_t{0});
+    fresh.capacity_ = capacity;
+    fresh.base_ = base;
+    fresh.width_ = width;
+    if (base == base_ && width == width_) {
+        if (size_ != 0) {
+            std::memcpy(fresh.words_.GetAddress(), words_.GetAddress(), WordsFor(size_, width) * sizeof(uint64_t));
+        }
+    } else {
+        for (size_t i = 0; i < size_; ++i) {
+            fresh.Store(i, (*this)[i] - base);
+        }
+    }
+    fresh.size_ = size_;
+    Swap(fresh);
+}
+
+inline void PackedIntVector::Widen(uint64_t value) {
+    uint64_t base = base_;
+    if (value < base_) {
+        const uint64_t shortfall = base_ - value;
+        base = value > shortfall ? value - shortfall : 0;
+    }
+    uint64_t max = value;
+    for (size_t i = 0; i < size_; ++i) {
+        max = std::max(max, (*this)[i]);
+    }
+    Reencode(capacity_, base, BitWidth(max - base));
+}
+
+inline void PackedIntVector::DecodeScalar(const PackedIntVector& vec, size_t first, size_t count, uint32_t* out) noexcept {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<uint32_t>(vec[first + i]);
+    }
+}
+
+#if VECTOR_SIMD_X86
+
+// Each value is at most 32 bits and starts at most 7 bits into its first
+// byte, so one unaligned 64-bit load per value, gathered four at a time,
+// holds it whole
+__attribute__((target("avx2")))
+inline void PackedIntVector::DecodeAvx2(const PackedIntVector& vec, size_t first, size_t count, uint32_t* out) noexcept {
+    const size_t width = vec.width_;
+    const auto* bytes = reinterpret_cast<const long long*>(vec.words_.GetAddress());
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(vec.Mask()));
+    const __m256i seven = _mm256_set1_epi64x(7);
+    const __m256i step = _mm256_set1_epi64x(static_cast<long long>(4 * width));
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    const __m128i base = _mm_set1_epi32(static_cast<int>(vec.base_));
+    const long long start = static_cast<long long>(first * width);
+    const long long w = static_cast<long long>(width);
+    __m256i bits = _mm256_setr_epi64x(start, start + w, start + 2 * w, start + 3 * w);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256i gathered = _mm256_i64gather_epi64(bytes, _mm256_srli_epi64(bits, 3), 1);
+        const __m256i values = _mm256_and_si256(_mm256_srlv_epi64(gathered, _mm256_and_si256(bits, seven)), mask);
+        const __m128i packed = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(values, low_halves));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi32(packed, base));
+        bits = _mm256_add_epi64(bits, step);
+    }
+    DecodeScalar(vec, first + i, count - i, out + i);
+}
+
+#endif  // VECTOR_SIMD_X86
@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+
+#include "vector.h"
+
+// ThreadPool is a small work-stealing pool. Every worker owns a task queue:
+// it pushes and pops work at the back of its own queue, while idle workers
+// steal from the front of the others' queues, taking the largest pending
+// ranges first. A thread waiting for a parallel loop runs tasks as well,
+// so nested parallel loops do not deadlock.
+class ThreadPool {
+public:
+    // Starts `num_threads - 1` workers: the thread calling ParallelFor
+    // is the last one
+    explicit ThreadPool(size_t num_threads = DefaultThreadCount());
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads taking part in a parallel loop
+    size_t ThreadCount() const noexcept { return workers_.Size() + 1; }
+
+    // Splits [0, size) into chunks of `grain` indices and calls
+    // `body(chunk_begin, chunk_end)` on each in parallel. Returns once all
+    // chunks are done, rethrowing the first exception thrown by `body`;
+    // chunks not yet started when it was thrown are skipped.
+    void ParallelFor(size_t size, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+    // Shared pool with DefaultThreadCount() threads
+    static ThreadPool& Default();
+    static size_t DefaultThreadCount() noexcept;
+
+    ~ThreadPool();
+
+private:
+    using Task = std::function<void()>;
+
+    static constexpr size_t kNoWorker = size_t(-1);
+
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct LoopState;
+
+    struct WorkerIdentity {
+        const ThreadPool* pool = nullptr;
+        size_t index = kNoWorker;
+    };
+
+    void Split(LoopState& state, size_t first_chunk, size_t last_chunk);
+    void Submit(Task task);
+    bool TryRunTask(size_t self);
+    void WorkerLoop(size_t index);
+    // Wakes the workers and waits for them to drain the queues and exit
+    void Stop() noexcept;
+
+    static WorkerIdentity& CurrentIdentity() noexcept;
+
+    // Index of the calling thread among this pool's workers, or kNoWorker
+    size_t CurrentWorker() const noexcept;
+
+    Vector<std::unique_ptr<TaskQueue>> queues_;
+    Vector<std::thread> workers_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_queue_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
+
+struct ParallelOptions {
+    // Elements per chunk. 0 picks a multiple of the cache line that gives
+    // every thread several chunks to balance the load.
+    size_t grain_size = 0;
+    // Pool to run on, ThreadPool::Default() if null
+    ThreadPool* pool = nullptr;
+};
+
+// Calls `fn(element)` for every element of a contiguous range such as Vector
+template <typename Range, typename Fn>
+void ParallelForEach(Range& range, Fn fn, const ParallelOptions& options = {});
+
+// Folds every chunk with `reduce(acc, element)` starting from `identity`,
+// then folds the chunk results in order with `combine(acc, partial)`. For a
+// fixed grain size the result does not depend on the number of threads.
+template <typename Range, typename R, typename Reduce, typename Combine>
+R ParallelReduce(const Range& range, R identity, Reduce reduce, Combine combine,
+                 const ParallelOptions& options = {});
+
+// Same as above with `op` used both to reduce and to combine
+template <typename Range, typename R, typename Op>
+R ParallelReduce(const Range& range, R identity, Op op, const ParallelOptions& options = {});
+
+// out[i] = fn(in[i]); both ranges must have the same size
+template <typename InRange, typename OutRange, typename Fn>
+void ParallelTransform(const InRange& in, OutRange& out, Fn fn, const ParallelOptions& options = {});
+
+
+// Implementation of ThreadPool class methods
+
+
+struct ThreadPool::LoopState {
+    LoopState(const std::function<void(size_t, size_t)>& body, size_t size, size_t grain) noexcept
+        : body(body), size(size), grain(grain) {}
+
+    const std::function<void(size_t, size_t)>& body;
+    size_t size;
+    size_t grain;
+    std::atomic<size_t> pending{0};
+    std::atomic<bool> failed{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    void Fail() noexcept {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+        failed.store(true, std::memory_order_relaxed);
+    }
+};
+
+inline ThreadPool::ThreadPool(size_t num_threads) {
+    const size_t num_workers = num_threads > 1 ? num_threads - 1 : 0;
+    // Without workers, tasks still need a queue for the waiting thread
+    for (size_t i = 0; i < std::max<size_t>(num_workers, 1); ++i) {
+        queues_.EmplaceBack(std::make_unique<TaskQueue>());
+    }
+    workers_.Reserve(num_workers);
+    try {
+        for (size_t i = 0; i < num_workers; ++i) {
+            workers_.EmplaceBack([this, i] { WorkerLoop(i); });
+        }
+    } catch (...) {
+        Stop();
+        throw;
+    }
+}
+
+inline ThreadPool::~ThreadPool() {
+    Stop();
+}
+
+inline ThreadPool& ThreadPool::Default() {
+    static ThreadPool pool;
+    return pool;
+}
+
+inline size_t ThreadPool::DefaultThreadCount() noexcept {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline void ThreadPool::ParallelFor(size_t size, size_t grain, const std::function<void(size_t, size_t)>& body) {
+    if (size == 0) {
+        return;
+    }
+    grain = std::max<size_t>(grain, 1);
+    LoopState state(body, size, grain);
+    try {
+        Split(state, 0, (size + grain - 1) / grain);
+    } catch (...) {
+        state.Fail();
+    }
+    const size_t self = CurrentWorker();
+    while (state.pending.load(std::memory_order_acquire) != 0) {
+        if (!TryRunTask(self)) {
+            std::this_thread::yield();
+        }
+    }
+    if (state.error) {
+        std::rethrow_exception(state.error);
+    }
+}
+
+inline void ThreadPool::Split(LoopState& state, size_t first_chunk, size_t last_chunk) {
+    // Hand off the upper half until a single chunk is left, so thieves
+    // take large ranges and split them further themselves
+    while (last_chunk - first_chunk > 1) {
+        const size_t middle = first_chunk + (last_chunk - first_chunk) / 2;
+        state.pending.fetch_add(1, std::memory_order_relaxed);
+        try {
+            Submit([this, &state, middle, last_chunk] {
+                try {
+                    Split(state, middle, last_chunk);
+                } catch (...) {
+                    state.Fail();
+                }
+                state.pending.fetch_sub(1, std::memory_order_release);
+            });
+        } catch (...) {
+            state.pending.fetch_sub(1, std::memory_order_relaxed);
+            throw;
+        }
+        last_chunk = middle;
+    }
+    if (!state.failed.load(std::memory_order_relaxed)) {
+        const size_t begin = first_chunk * state.grain;
+        state.body(begin, std::min(state.size, begin + state.grain));
+    }
+}
+
+inline void ThreadPool::Submit(Task task) {
+    const size_t self = CurrentWorker();
+    const size_t index = self != kNoWorker ? self : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.Size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in WorkerLoop to avoid a lost wakeup
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+    }
+    wake_.notify_one();
+}
+
+inline bool ThreadPool::TryRunTask(size_t self) {
+    if (queued_.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    Task task;
+    const size_t num_queues = queues_.Size();
+    const size_t start = self != kNoWorker ? self : next_queue_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < num_queues && !task; ++i) {
+        const size_t index = (start + i) % num_queues;
+        TaskQueue& queue = *queues_[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (index == self) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+inline void ThreadPool::WorkerLoop(size_t index) {
+    CurrentIdentity() = {this, index};
+    while (true) {
+        if (TryRunTask(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_acquire) != 0; });
+        if (stop_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+inline void ThreadPool::Stop() noexcept {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+    workers_.Resize(0);
+}
+
+inline ThreadPool::WorkerIdentity& ThreadPool::CurrentIdentity() noexcept {
+    static thread_local WorkerIdentity identity;
+    return identity;
+}
+
+inline size_t ThreadPool::CurrentWorker() const noexcept {
+    const WorkerIdentity& identity = CurrentIdentity();
+    return identity.pool == this ? identity.index : kNoWorker;
+}
+
+
+// Implementation of parallel algorithms
+
+
+template <typename T>
+size_t DefaultGrainSize(size_t size, const ThreadPool& pool) noexcept {
+    constexpr size_t kCacheLineBytes = 64;
+    constexpr size_t kMinChunkBytes = size_t{16} << 10;
+    const size_t per_line = std::max<size_t>(1, kCacheLineBytes / sizeof(T));
+    // About eight chunks per thread leave room for stealing to even out
+    // uneven work, while chunks of at least 16 KiB amortize the task cost
+    const size_t balanced = size / (pool.ThreadCount() * 8) + 1;
+    const size_t grain = std::max(balanced, std::max(per_line, kMinChunkBytes / sizeof(T)));
+    return (grain + per_line - 1) / per_line * per_line;
+}
+
+template <typename Range, typename Fn>
+void ParallelForEach(Range& range, Fn fn, const ParallelOptions& options) {
+    auto first = std::begin(range);
+    const size_t size = std::distance(first, std::end(range));
+    using T = std::remove_reference_t<decltype(*first)>;
+    ThreadPool& pool = options.pool != nullptr ? *options.pool : ThreadPool::Default();
+    const size_t grain = options.grain_size != 0 ? options.grain_size : DefaultGrainSize<T>(size, pool);
+    pool.ParallelFor(size, grain, [&](size_t begin, size_t end) {
+        for (auto it = first + begin, last = first + end; it != last; ++it) {
+            fn(*it);
+        }
+    });
+}
+
+template <typename Range, typename R, typename Reduce, typename Combine>
+R ParallelReduce(const Range& range, R identity, Reduce reduce, Combine combine, const ParallelOptions& options) {
+    auto first = std::begin(range);
+    const size_t size = std::distance(first, std::end(range));
+    using T = std::remove_reference_t<decltype(*first)>;
+    ThreadPool& pool = options.pool != nullptr ? *options.pool : ThreadPool::Default();
+    const size_t grain = options.grain_size != 0 ? options.grain_size : DefaultGrainSize<T>(size, pool);
+    Vector<std::optional<R>> partials(size == 0 ? 0 : (size + grain - 1) / grain);
+    pool.ParallelFor(size, grain, [&](size_t begin, size_t end) {
+        R acc = identity;
+        for (auto it = first + begin, last = first + end; it != last; ++it) {
+            acc = reduce(std::move(acc), *it);
+        }
+        partials[begin / grain].emplace(std::move(acc));
+    });
+    for (std::optional<R>& partial : partials) {
+        identity = combine(std::move(identity), std::move(*partial));
+    }
+    return identity;
+}
+
+template <typename Range, typename R, typename Op>
+R ParallelReduce(const Range& range, R identity, Op op, const ParallelOptions& options) {
+    return ParallelReduce(range, std::move(identity), op, op, options);
+}
+
+template <typename InRange, typename OutRange, typename Fn>
+void ParallelTransform(const InRange& in, OutRange& out, Fn fn, const ParallelOptions& options) {
+    auto in_first = std::begin(in);
+    auto out_first = std::begin(out);
+    const size_t size = std::distance(in_first, std::end(in));
+    assert(size == static_cast<size_t>(std::distance(out_first, std::end(out))));
+    using T = std::remove_reference_t<decltype(*out_first)>;
+    ThreadPool& pool = options.pool != nullptr ? *options.pool : ThreadPool::Default();
+    // Chunks of whole cache lines keep threads from writing to the same line
+    const size_t grain = options.grain_size != 0 ? options.grain_size : DefaultGrainSize<T>(size, pool);
+    pool.ParallelFor(size, grain, [&](size_t begin, size_t end) {
+        std::transform(in_first + begin, in_first + end, out_first + begin, fn);
+    });
+}
@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+// Limits of a BufferPool. Only buffers of at most `max_buffer_bytes` are
+// cached, and a pool never holds more than `max_cached_bytes` in total.
+struct BufferPoolLimits {
+    size_t max_cached_bytes = size_t{4} << 20;
+    size_t max_buffer_bytes = size_t{1} << 20;
+};
+
+// BufferPool recycles freed buffers in power-of-two size classes.
+// Requests are rounded up to the size class, so a buffer returned by one
+// RawMemory can be handed as-is to the next one asking for a similar size.
+// Every thread owns a lock-free `Local()` pool; buffers that do not fit in
+// it overflow into the mutex-protected `Global()` pool, which is also where
+// a thread-local miss looks before falling back to `operator new`.
+class BufferPool {
+public:
+    // Buffers above this size bypass the size classes entirely
+    static constexpr size_t kMaxClassBytes = size_t{1} << 26;
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t cached_bytes = 0;
+    };
+
+    explicit BufferPool(const BufferPoolLimits& limits = {}, BufferPool* fallback = nullptr,
+                        bool shared = false) noexcept;
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    void* Allocate(size_t bytes);
+    void Deallocate(void* ptr, size_t bytes) noexcept;
+
+    // True if buffers of `old_bytes` and `new_bytes` share a size class,
+    // i.e. the buffer already has room for `new_bytes`
+    static bool SameClass(size_t old_bytes, size_t new_bytes) noexcept;
+
+    // Releases cached buffers, largest first, until at most
+    // `max_cached_bytes` remain. Released buffers go to the fallback pool.
+    void Trim(size_t max_cached_bytes = 0) noexcept;
+
+    void SetLimits(const BufferPoolLimits& limits) noexcept;
+    Stats GetStats() const noexcept;
+
+    // Pool of the calling thread
+    static BufferPool& Local();
+    // Process-wide pool shared by all threads
+    static BufferPool& Global();
+
+    ~BufferPool();
+
+private:
+    static constexpr size_t kMinClassShift = 4;
+    static constexpr size_t kNumClasses = 23;
+
+    struct FreeBuffer {
+        FreeBuffer* next;
+    };
+
+    static size_t ClassIndex(size_t bytes) noexcept;
+    static size_t ClassBytes(size_t index) noexcept;
+
+    std::unique_lock<std::mutex> Lock() const noexcept;
+    void* TryPop(size_t index) noexcept;
+    bool TryPush(void* ptr, size_t index) noexcept;
+
+    FreeBuffer* free_lists_[kNumClasses] = {};
+    BufferPoolLimits limits_;
+    BufferPool* fallback_;
+    bool shared_;
+    mutable std::mutex mutex_;
+    Stats stats_;
+};
+
+// Stateless allocator backed by the calling thread's BufferPool
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    PoolAllocator() noexcept = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& /*other*/) noexcept {}
+
+    T* allocate(size_t n) {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return std::allocator<T>().allocate(n);
+        } else {
+            if (n > size_t(-1) / sizeof(T)) {
+                throw std::bad_array_new_length();
+            }
+            return static_cast<T*>(BufferPool::Local().Allocate(n * sizeof(T)));
+        }
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            std::allocator<T>().deallocate(p, n);
+        } else {
+            BufferPool::Local().Deallocate(p, n * sizeof(T));
+        }
+    }
+
+    // In-place growth hook used by RawMemory::TryExtend: the size class
+    // may already have room for the new capacity.
+    bool try_extend(T* /*p*/, size_t old_n, size_t new_n) noexcept {
+        if constexpr (alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return false;
+        } else {
+            return new_n <= size_t(-1) / sizeof(T) && BufferPool::SameClass(old_n * sizeof(T), new_n * sizeof(T));
+        }
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& /*other*/) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& /*other*/) const noexcept {
+        return false;
+    }
+};
+
+
+// Implementation of BufferPool methods
+
+
+inline BufferPool::BufferPool(const BufferPoolLimits& limits, BufferPool* fallback, bool shared) noexcept
+    : limits_(limits), fallback_(fallback), shared_(shared) {}
+
+inline void* BufferPool::Allocate(size_t bytes) {
+    if (bytes > kMaxClassBytes) {
+        return operator new(bytes);
+    }
+    const size_t index = ClassIndex(bytes);
+    if (void* ptr = TryPop(index)) {
+        return ptr;
+    }
+    if (fallback_ != nullptr) {
+        if (void* ptr = fallback_->TryPop(index)) {
+            return ptr;
+        }
+    }
+    return operator new(ClassBytes(index));
+}
+
+inline void BufferPool::Deallocate(void* ptr, size_t bytes) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (bytes > kMaxClassBytes) {
+        operator delete(ptr);
+        return;
+    }
+    const size_t index = ClassIndex(bytes);
+    if (TryPush(ptr, index)) {
+        return;
+    }
+    if (fallback_ != nullptr && fallback_->TryPush(ptr, index)) {
+        return;
+    }
+    operator delete(ptr);
+}
+
+inline bool BufferPool::SameClass(size_t old_bytes, size_t new_bytes) noexcept {
+    return old_bytes != 0 && old_bytes <= kMaxClassBytes && new_bytes <= kMaxClassBytes
+        && ClassIndex(old_bytes) == ClassIndex(new_bytes);
+}
+
+inline void BufferPool::Trim(size_t max_cached_bytes) noexcept {
+    auto lock = Lock();
+    for (size_t index = kNumClasses; index-- > 0 && stats_.cached_bytes > max_cached_bytes;) {
+        while (free_lists_[index] != nullptr && stats_.cached_bytes > max_cached_bytes) {
+            FreeBuffer* buffer = free_lists_[index];
+            free_lists_[index] = buffer->next;
+            stats_.cached_bytes -= ClassBytes(index);
+            if (fallback_ == nullptr || !fallback_->TryPush(buffer, index)) {
+                operator delete(buffer);
+            }
+        }
+    }
+}
+
+inline void BufferPool::SetLimits(const BufferPoolLimits& limits) noexcept {
+    {
+        auto lock = Lock();
+        limits_ = limits;
+    }
+    Trim(limits.max_cached_bytes);
+}
+
+inline BufferPool::Stats BufferPool::GetStats() const noexcept {
+    auto lock = Lock();
+    return stats_;
+}
+
+inline BufferPool& BufferPool::Local() {
+    static thread_local BufferPool pool(BufferPoolLimits{}, &Global());
+    return pool;
+}
+
+inline BufferPool& BufferPool::Global() {
+    static BufferPool pool(BufferPoolLimits{size_t{64} << 20, kMaxClassBytes}, nullptr, true);
+    return pool;
+}
+
+inline BufferPool::~BufferPool() {
+    Trim();
+}
+
+inline size_t BufferPool::ClassIndex(size_t bytes) noexcept {
+    if (bytes <= ClassBytes(0)) {
+        return 0;
+    }
+    return 64 - __builtin_clzll(static_cast<unsigned long long>(bytes - 1)) - kMinClassShift;
+}
+
+inline size_t BufferPool::ClassBytes(size_t index) noexcept {
+    return size_t{1} << (index + kMinClassShift);
+}
+
+inline std::unique_lock<std::mutex> BufferPool::Lock() const noexcept {
+    return shared_ ? std::unique_lock<std::mutex>(mutex_) : std::unique_lock<std::mutex>();
+}
+
+inline void* BufferPool::TryPop(size_t index) noexcept {
+    auto lock = Lock();
+    FreeBuffer* buffer = free_lists_[index];
+    if (buffer == nullptr) {
+        ++stats_.misses;
+        return nullptr;
+    }
+    free_lists_[index] = buffer->next;
+    stats_.cached_bytes -= ClassBytes(index);
+    ++stats_.hits;
+    return buffer;
+}
+
+inline bool BufferPool::TryPush(void* ptr, size_t index) noexcept {
+    auto lock = Lock();
+    const size_t bytes = ClassBytes(index);
+    if (bytes > limits_.max_buffer_bytes || stats_.cached_bytes + bytes > limits_.max_cached_bytes) {
+        return false;
+    }
+    auto* buffer = static_cast<FreeBuffer*>(ptr);
+    buffer->next = free_lists_[index];
+    free_lists_[index] = buffer;
+    stats_.cached_bytes += bytes;
+    return true;
+}
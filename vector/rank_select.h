@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "bit_vector.h"
+#include "vector.h"
+
+// Rank/select index over a BitVector, in the layout of CS-Poppy:
+//
+// - every 2^32 bits, a 64-bit count of the ones before them (L0);
+// - every 2048-bit basic block, one 64-bit entry holding the ones before
+//   the block relative to its L0 (32 bits) and the ones in the first three
+//   of its four 512-bit sub-blocks (10 bits each);
+// - the basic block holding every 8192nd one, and every 8192nd zero.
+//
+// Rank reads one entry and popcounts at most eight words. Select starts at
+// the sampled block, binary searches the entries up to the next sample and
+// finishes like rank. The index takes about 3.5% of the bits' space.
+//
+// The index is built on the first query, or by Build(). It describes the
+// bits as they were then: after modifying the BitVector, call Invalidate()
+// or Build(). Queries that may build the index must not run concurrently;
+// once it is built they are read-only.
+class RankSelect {
+public:
+    explicit RankSelect(const BitVector& bits) noexcept : bits_(&bits) {}
+
+    void Build();
+    void Invalidate() noexcept { built_ = false; }
+
+    // Number of ones/zeros in [0, pos), pos <= Size()
+    size_t Rank1(size_t pos) const;
+    size_t Rank0(size_t pos) const { return pos - Rank1(pos); }
+
+    // Position of the one/zero with the given zero-based rank, which must
+    // be below Ones()/Zeros()
+    size_t Select1(size_t rank) const;
+    size_t Select0(size_t rank) const;
+
+    size_t Ones() const;
+    size_t Zeros() const { return Size() - Ones(); }
+    size_t Size() const noexcept { return bits_->Size(); }
+
+    // Memory taken by the index
+    size_t IndexBytes() const noexcept;
+
+private:
+    static constexpr size_t kBlockBits = 2048;
+    static constexpr size_t kBlockWords = kBlockBits / BitVector::kWordBits;
+    static constexpr size_t kSubBlockBits = 512;
+    static constexpr size_t kSubBlockWords = kSubBlockBits / BitVector::kWordBits;
+    static constexpr size_t kUpperShift = 32 - 11;  // basic blocks per 2^32 bits
+    static constexpr size_t kSelectSample = 8192;
+
+    const BitVector* bits_;
+    // The index is built lazily by const queries
+    mutable Vector<uint64_t> upper_;
+    mutable Vector<uint64_t> blocks_;
+    mutable Vector<uint32_t> samples1_;
+    mutable Vector<uint32_t> samples0_;
+    mutable size_t ones_ = 0;
+    mutable bool built_ = false;
+
+    void EnsureBuilt() const;
+
+    // Ones before basic block `block`
+    size_t BlockRank(size_t block) const noexcept {
+        return upper_[block >> kUpperShift] + static_cast<uint32_t>(blocks_[block]);
+    }
+
+    static size_t SubBlockCount(uint64_t entry, size_t sub_block) noexcept {
+        return (entry >> (32 + 10 * sub_block)) & 0x3ff;
+    }
+
+    template <bool kOne>
+    size_t Select(size_t rank) const;
+
+    // Position of the set bit of `word` with the given rank
+    static size_t SelectInWord(uint64_t word, size_t rank) noexcept;
+};
+
+
+// Implementation of RankSelect class methods
+
+
+inline void RankSelect::Build() {
+    const uint64_t* words = bits_->Words();
+    const size_t word_count = bits_->WordCount();
+    const size_t size = bits_->Size();
+    const size_t block_count = (word_count + kBlockWords - 1) / kBlockWords;
+    assert(block_count < (size_t{1} << 32));
+
+    // One more entry serves Rank1(Size()) when Size() ends a block
+    upper_.Resize((block_count >> kUpperShift) + 1);
+    blocks_.Resize(block_count + 1);
+    samples1_.Resize(0);
+    samples0_.Resize(0);
+    size_t ones = 0;
+    size_t next_sample1 = 0;
+    size_t next_sample0 = 0;
+    for (size_t block = 0; block <= block_count; ++block) {
+        if ((block & ((size_t{1} << kUpperShift) - 1)) == 0) {
+            upper_[block >> kUpperShift] = ones;
+        }
+        uint64_t entry = ones - upper_[block >> kUpperShift];
+        size_t block_ones = 0;
+        for (size_t sub_block = 0; sub_block < 4; ++sub_block) {
+            const size_t first = block * kBlockWords + sub_block * kSubBlockWords;
+            size_t count = 0;
+            for (size_t i = first; i < first + kSubBlockWords && i < word_count; ++i) {
+                count += __builtin_popcountll(words[i]);
+            }
+            if (sub_block < 3) {
+                entry |= uint64_t(count) << (32 + 10 * sub_block);
+            }
+            block_ones += count;
+        }
+        blocks_[block] = entry;
+        if (block == block_count) {
+            break;
+        }
+        const size_t block_bits = std::min(kBlockBits, size - block * kBlockBits);
+        const size_t zeros = block * kBlockBits - ones;
+        ones += block_ones;
+        for (; next_sample1 < ones; next_sample1 += kSelectSample) {
+            samples1_.PushBack(static_cast<uint32_t>(block));
+        }
+        for (; next_sample0 < zeros + block_bits - block_ones; next_sample0 += kSelectSample) {
+            samples0_.PushBack(static_cast<uint32_t>(block));
+        }
+    }
+    // Sentinels bounding the search after the last sample
+    samples1_.PushBack(static_cast<uint32_t>(block_count));
+    samples0_.PushBack(static_cast<uint32_t>(block_count));
+    // Exact capacities keep the overhead at the figure above after rebuilds
+    upper_.ShrinkToFit();
+    blocks_.ShrinkToFit();
+    samples1_.ShrinkToFit();
+    samples0_.ShrinkToFit();
+    ones_ = ones;
+    built_ = true;
+}
+
+inline size_t RankSelect::Rank1(size_t pos) const {
+    EnsureBuilt();
+    assert(pos <= Size());
+    const uint64_t* words = bits_->Words();
+    const size_t block = pos / kBlockBits;
+    const uint64_t entry = blocks_[block];
+    size_t rank = BlockRank(block);
+    const size_t sub_block = pos % kBlockBits / kSubBlockBits;
+    for (size_t i = 0; i < sub_block; ++i) {
+        rank += SubBlockCount(entry, i);
+    }
+    const size_t last = pos / BitVector::kWordBits;
+    for (size_t i = block * kBlockWords + sub_block * kSubBlockWords; i < last; ++i) {
+        rank += __builtin_popcountll(words[i]);
+    }
+    if (pos % BitVector::kWordBits != 0) {
+        rank += __builtin_popcountll(words[last] & ((uint64_t{1} << (pos % BitVector::kWordBits)) - 1));
+    }
+    return rank;
+}
+
+inline size_t RankSelect::Select1(size_t rank) const {
+    return Select<true>(rank);
+}
+
+inline size_t RankSelect::Select0(size_t rank) const {
+    return Select<false>(rank);
+}
+
+inline size_t RankSelect::Ones() const {
+    EnsureBuilt();
+    return ones_;
+}
+
+inline size_t RankSelect::IndexBytes() const noexcept {
+    return upper_.Capacity() * sizeof(uint64_t) + blocks_.Capacity() * sizeof(uint64_t)
+        + (samples1_.Capacity() + samples0_.Capacity()) * sizeof(uint32_t);
+}
+
+inline void RankSelect::EnsureBuilt() const {
+    if (!built_) {
+        const_cast<RankSelect*>(this)->Build();
+    }
+}
+
+template <bool kOne>
+size_t RankSelect::Select(size_t rank) const {
+    EnsureBuilt();
+    assert(rank < (kOne ? Ones() : Zeros()));
+    const Vector<uint32_t>& samples = kOne ? samples1_ : samples0_;
+    auto before = [this](size_t block) {
+        const size_t ones = BlockRank(block);
+        return kOne ? ones : block * kBlockBits - ones;
+    };
+
+    // The last block in [lo, hi) with at most `rank` ones (zeros) before it
+    const size_t sample = rank / kSelectSample;
+    size_t lo = samples[sample];
+    size_t hi = samples[sample + 1] + 1;
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+        if (before(mid) <= rank) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    rank -= before(lo);
+
+    const uint64_t entry = blocks_[lo];
+    size_t sub_block = 0;
+    for (; sub_block < 3; ++sub_block) {
+        const size_t count = kOne ? SubBlockCount(entry, sub_block) : kSubBlockBits - SubBlockCount(entry, sub_block);
+        if (rank < count) {
+            break;
+        }
+        rank -= count;
+    }
+    const uint64_t* words = bits_->Words();
+    for (size_t i = lo * kBlockWords + sub_block * kSubBlockWords;; ++i) {
+        const uint64_t word = kOne ? words[i] : ~words[i];
+        const size_t count = __builtin_popcountll(word);
+        if (rank < count) {
+            return i * BitVector::kWordBits + SelectInWord(word, rank);
+        }
+        rank -= count;
+    }
+}
+
+inline size_t RankSelect::SelectInWord(uint64_t word, size_t rank) noexcept {
+    // Narrows down to the byte holding the bit, then clears the lower bits
+    size_t offset = 0;
+    for (;; offset += 8) {
+        const size_t count = __builtin_popcountll((word >> offset) & 0xff);
+        if (rank < count) {
+            break;
+        }
+        rank -= count;
+    }
+    uint64_t byte = (word >> offset) & 0xff;
+    for (; rank > 0; --rank) {
+        byte &= byte - 1;
+    }
+    return offset + __builtin_ctzll(byte);
+}
@@ -1,10 +1,60 @@
-#pragma once 
-
-template <typename T>
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Allocators may optionally provide
+//     bool try_extend(T* p, size_t old_n, size_t new_n) noexcept;
+// which resizes the block at `p` without moving it. RawMemory uses it to grow
+// in place when the allocator can do so (see MonotonicArena).
+template <typename Alloc, typename T, typename = void>
+struct HasTryExtend : std::false_type {};
+
+template <typename Alloc, typename T>
+struct HasTryExtend<Alloc, T, std::void_t<decltype(std::declval<Alloc&>().try_extend(
+                                  std::declval<T*>(), size_t{}, size_t{}))>> : std::true_type {};
+
+// Allocators may also provide
+//     T* reallocate(T* p, size_t old_n, size_t new_n) noexcept;
+// which resizes the block at `p`, moving its bytes if needed, and returns
+// nullptr on failure. Since objects are moved bytewise, RawMemory only offers
+// it through TryReallocate, for trivially relocatable elements.
+template <typename Alloc, typename T, typename = void>
+struct HasReallocate : std::false_type {};
+
+template <typename Alloc, typename T>
+struct HasReallocate<Alloc, T, std::void_t<decltype(std::declval<Alloc&>().reallocate(
+                                   std::declval<T*>(), size_t{}, size_t{}))>> : std::true_type {};
+
+// Allocators may also declare
+//     using pinned_buffers = std::true_type;
+// to promise that a buffer never moves once allocated. Growth that cannot be
+// served in place then throws std::bad_alloc rather than relocating the
+// elements (see VirtualMemoryAllocator).
+template <typename Alloc, typename = void>
+struct HasPinnedBuffers : std::false_type {};
+
+template <typename Alloc>
+struct HasPinnedBuffers<Alloc, std::void_t<typename Alloc::pinned_buffers>> : Alloc::pinned_buffers {};
+
+// RawMemory owns an uninitialized buffer obtained from an allocator.
+// `Alloc` is rebound to `T`, so both `RawMemory<T, MyAlloc<T>>` and
+// `RawMemory<T, MyAlloc<char>>` are accepted. Move construction takes the
+// allocator along with the buffer. Move assignment and Swap exchange buffers
+// only, so the allocators must compare equal unless they propagate; the
+// container-level rules (propagate_on_container_*) are applied by `Vector`.
+template <typename T, typename Alloc = std::allocator<T>>
 class RawMemory {
 public:
+    using allocator_type = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
     RawMemory() = default;
-    explicit RawMemory(size_t capacity);
+    explicit RawMemory(const allocator_type& alloc) noexcept;
+    explicit RawMemory(size_t capacity, const allocator_type& alloc = allocator_type());
     RawMemory(RawMemory&& other) noexcept;
     RawMemory& operator=(RawMemory&& rhs) noexcept;
 
@@ -16,16 +66,38 @@ public:
     const T& operator[](size_t index) const noexcept;
     T& operator[](size_t index) noexcept;
 
+    // Swaps the buffers. The allocators must compare equal.
     void Swap(RawMemory& other) noexcept;
+
+    // Swaps the buffers together with the allocators
+    void SwapWithAllocator(RawMemory& other) noexcept;
+
+    // Changes the capacity without moving the buffer. Returns false if
+    // the allocator cannot resize the block in place.
+    bool TryExtend(size_t new_capacity) noexcept;
+
+    // Like TryExtend, but throws std::bad_alloc instead of returning false
+    // if the allocator pins its buffers and this one is already allocated
+    bool ExtendInPlace(size_t new_capacity);
+
+    // Changes the capacity, letting the allocator move the buffer bytewise
+    // (e.g. via realloc or mremap). Must only be used while the buffer holds
+    // trivially relocatable objects. Returns false if unsupported or failed.
+    bool TryReallocate(size_t new_capacity) noexcept;
+
     const T* GetAddress() const noexcept;
     T* GetAddress() noexcept;
     size_t Capacity() const;
+    const allocator_type& GetAllocator() const noexcept;
     ~RawMemory();
 
 private:
-    static T* Allocate(size_t n);
-    static void Deallocate(T* buf) noexcept;
+    using AllocTraits = std::allocator_traits<allocator_type>;
 
+    T* Allocate(size_t n);
+    void Deallocate(T* buf, size_t n) noexcept;
+
+    allocator_type alloc_;
     T* buffer_ = nullptr;
     size_t capacity_ = 0;
 };
@@ -34,79 +106,143 @@ private:
 // Implementation of RawMemory class template methods
 
 
-template <typename T>
-RawMemory<T>::RawMemory(size_t capacity)
-    : buffer_(Allocate(capacity)), capacity_(capacity) {}
+template <typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(const allocator_type& alloc) noexcept
+    : alloc_(alloc) {}
 
-template <typename T>
-RawMemory<T>::RawMemory(RawMemory&& other) noexcept {
-    Swap(other);
-}
+template <typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(size_t capacity, const allocator_type& alloc)
+    : alloc_(alloc), buffer_(Allocate(capacity)), capacity_(capacity) {}
+
+template <typename T, typename Alloc>
+RawMemory<T, Alloc>::RawMemory(RawMemory&& other) noexcept
+    : alloc_(std::move(other.alloc_))
+    , buffer_(std::exchange(other.buffer_, nullptr))
+    , capacity_(std::exchange(other.capacity_, 0)) {}
 
-template <typename T>
-RawMemory<T>& RawMemory<T>::operator=(RawMemory&& rhs) noexcept {
+template <typename T, typename Alloc>
+RawMemory<T, Alloc>& RawMemory<T, Alloc>::operator=(RawMemory&& rhs) noexcept {
     if (this != &rhs) {
-        Deallocate(buffer_);
+        Deallocate(buffer_, capacity_);
+        if constexpr (AllocTraits::propagate_on_container_move_assignment::value) {
+            alloc_ = std::move(rhs.alloc_);
+        } else {
+            assert(alloc_ == rhs.alloc_);
+        }
         buffer_ = std::exchange(rhs.buffer_, nullptr);
         capacity_ = std::exchange(rhs.capacity_, 0);
     }
     return *this;
 }
 
-template <typename T>
-T* RawMemory<T>::operator+(size_t offset) noexcept {
+template <typename T, typename Alloc>
+T* RawMemory<T, Alloc>::operator+(size_t offset) noexcept {
     assert(offset <= capacity_);
     return buffer_ + offset;
 }
 
-template <typename T>
-const T* RawMemory<T>::operator+(size_t offset) const noexcept {
+template <typename T, typename Alloc>
+const T* RawMemory<T, Alloc>::operator+(size_t offset) const noexcept {
     return const_cast<RawMemory&>(*this) + offset;
 }
 
-template <typename T>
-const T& RawMemory<T>::operator[](size_t index) const noexcept {
+template <typename T, typename Alloc>
+const T& RawMemory<T, Alloc>::operator[](size_t index) const noexcept {
     return const_cast<RawMemory&>(*this)[index];
 }
 
-template <typename T>
-T& RawMemory<T>::operator[](size_t index) noexcept {
+template <typename T, typename Alloc>
+T& RawMemory<T, Alloc>::operator[](size_t index) noexcept {
     assert(index < capacity_);
     return buffer_[index];
 }
 
-template <typename T>
-void RawMemory<T>::Swap(RawMemory& other) noexcept {
+template <typename T, typename Alloc>
+void RawMemory<T, Alloc>::Swap(RawMemory& other) noexcept {
+    assert(alloc_ == other.alloc_);
     std::swap(buffer_, other.buffer_);
     std::swap(capacity_, other.capacity_);
 }
 
-template <typename T>
-const T* RawMemory<T>::GetAddress() const noexcept {
+template <typename T, typename Alloc>
+void RawMemory<T, Alloc>::SwapWithAllocator(RawMemory& other) noexcept {
+    using std::swap;
+    swap(alloc_, other.alloc_);
+    swap(buffer_, other.buffer_);
+    swap(capacity_, other.capacity_);
+}
+
+template <typename T, typename Alloc>
+bool RawMemory<T, Alloc>::TryExtend(size_t new_capacity) noexcept {
+    if constexpr (HasTryExtend<allocator_type, T>::value) {
+        if (buffer_ != nullptr && alloc_.try_extend(buffer_, capacity_, new_capacity)) {
+            capacity_ = new_capacity;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T, typename Alloc>
+bool RawMemory<T, Alloc>::ExtendInPlace(size_t new_capacity) {
+    if (TryExtend(new_capacity)) {
+        return true;
+    }
+    if constexpr (HasPinnedBuffers<allocator_type>::value) {
+        if (buffer_ != nullptr) {
+            throw std::bad_alloc();
+        }
+    }
+    return false;
+}
+
+template <typename T, typename Alloc>
+bool RawMemory<T, Alloc>::TryReallocate(size_t new_capacity) noexcept {
+    if constexpr (HasReallocate<allocator_type, T>::value) {
+        if (buffer_ != nullptr) {
+            if (T* new_buffer = alloc_.reallocate(buffer_, capacity_, new_capacity)) {
+                buffer_ = new_buffer;
+                capacity_ = new_capacity;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+template <typename T, typename Alloc>
+const T* RawMemory<T, Alloc>::GetAddress() const noexcept {
     return buffer_;
 }
 
-template <typename T>
-T* RawMemory<T>::GetAddress() noexcept {
+template <typename T, typename Alloc>
+T* RawMemory<T, Alloc>::GetAddress() noexcept {
     return buffer_;
 }
 
-template <typename T>
-size_t RawMemory<T>::Capacity() const {
+template <typename T, typename Alloc>
+size_t RawMemory<T, Alloc>::Capacity() const {
     return capacity_;
 }
 
-template <typename T>
-RawMemory<T>::~RawMemory() {
-    Deallocate(buffer_);
+template <typename T, typename Alloc>
+const typename RawMemory<T, Alloc>::allocator_type& RawMemory<T, Alloc>::GetAllocator() const noexcept {
+    return alloc_;
 }
 
-template <typename T>
-T* RawMemory<T>::Allocate(size_t n) {
-    return n != 0 ? static_cast<T*>(operator new(n * sizeof(T))) : nullptr;
+template <typename T, typename Alloc>
+RawMemory<T, Alloc>::~RawMemory() {
+    Deallocate(buffer_, capacity_);
 }
 
-template <typename T>
-void RawMemory<T>::Deallocate(T* buf) noexcept {
-    operator delete(buf);
+template <typename T, typename Alloc>
+T* RawMemory<T, Alloc>::Allocate(size_t n) {
+    return n != 0 ? AllocTraits::allocate(alloc_, n) : nullptr;
+}
+
+template <typename T, typename Alloc>
+void RawMemory<T, Alloc>::Deallocate(T* buf, size_t n) noexcept {
+    if (buf != nullptr) {
+        AllocTraits::deallocate(alloc_, buf, n);
+    }
 }
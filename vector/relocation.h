@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+// A type is trivially relocatable if moving an object to a new address and
+// destroying the original is equivalent to copying its bytes. This holds for
+// every trivially copyable type and, in practice, for most types that merely
+// own resources through pointers. Containers use it to relocate elements with
+// memcpy/memmove instead of a move-construct + destroy pair per element.
+//
+// User types opt in by specializing the trait:
+//     template <>
+//     struct IsTriviallyRelocatable<MyType> : std::true_type {};
+template <typename T>
+struct IsTriviallyRelocatable : std::bool_constant<std::is_trivially_copyable_v<T>> {};
+
+template <typename T>
+struct IsTriviallyRelocatable<std::unique_ptr<T>> : std::true_type {};
+
+template <typename T>
+inline constexpr bool kIsTriviallyRelocatable = IsTriviallyRelocatable<std::remove_cv_t<T>>::value;
+
+// Relocates `count` objects from `from` to the uninitialized memory at `to`.
+// The source objects must be treated as destroyed afterwards. The ranges
+// must not overlap.
+template <typename T>
+void TrivialRelocate(T* from, size_t count, T* to) noexcept {
+    static_assert(kIsTriviallyRelocatable<T>);
+    if (count != 0) {
+        std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+    }
+}
+
+// Same as TrivialRelocate, but the ranges may overlap
+template <typename T>
+void TrivialRelocateOverlapping(T* from, size_t count, T* to) noexcept {
+    static_assert(kIsTriviallyRelocatable<T>);
+    if (count != 0) {
+        std::memmove(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(T));
+    }
+}
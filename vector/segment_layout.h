@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+
+// Index arithmetic for containers made of segments of doubling size. The
+// first segment holds about `FirstSegmentBytes` worth of elements, rounded
+// down to a power of two B, and segment k holds B << k elements starting at
+// index B * (2^k - 1). Locating an element takes a shift and a bit scan.
+template <typename T, size_t FirstSegmentBytes = 1024>
+struct SegmentLayout {
+    static constexpr size_t kFirstShift = [] {
+        size_t shift = 0;
+        while ((size_t{2} << shift) * sizeof(T) <= FirstSegmentBytes) {
+            ++shift;
+        }
+        return shift;
+    }();
+    // Enough segments to address every index representable in size_t
+    static constexpr size_t kMaxSegments = 64 - kFirstShift;
+
+    static size_t SegmentOf(size_t index) noexcept {
+        return 63 - __builtin_clzll((index >> kFirstShift) + 1);
+    }
+
+    static size_t SegmentStart(size_t segment) noexcept {
+        return ((size_t{1} << segment) - 1) << kFirstShift;
+    }
+
+    static size_t SegmentSize(size_t segment) noexcept {
+        return size_t{1} << (segment + kFirstShift);
+    }
+};
@@ -0,0 +1,407 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "vector.h"
+
+// Binary format for Vector. A 64-byte SerialHeader is followed by the
+// payload:
+//   - trivially copyable elements are stored as their raw bytes, written
+//     and read with a single call;
+//   - std::string and nested Vector elements are stored as a 64-bit length
+//     followed by their own payload.
+// The header records the element type, its size and alignment, the byte
+// order and a checksum of the payload. Load rejects mismatches instead of
+// converting. Flat vectors can also be viewed in place with View, without
+// copying.
+
+// Identifies an element type in the header. Nested vectors add one level
+// of depth in the upper 16 bits to the tag of their innermost type.
+// Trivially copyable user types may specialize it with a unique value
+// below 0x10000; unspecialized ones are only checked by size and alignment.
+template <typename T, typename = void>
+struct SerialTypeTag {
+    static constexpr uint32_t value = 0;
+};
+
+template <typename T>
+struct SerialTypeTag<T, std::enable_if_t<std::is_arithmetic_v<T>>> {
+    // Kind in the high byte: 1 bool, 2 signed, 3 unsigned, 4 floating point
+    static constexpr uint32_t kKind = std::is_same_v<T, bool> ? 1
+                                      : std::is_floating_point_v<T> ? 4
+                                      : std::is_signed_v<T> ? 2 : 3;
+    static constexpr uint32_t value = kKind << 8 | sizeof(T);
+};
+
+template <>
+struct SerialTypeTag<std::string> {
+    static constexpr uint32_t value = 0x1000;
+};
+
+template <typename T, typename Alloc, typename Growth>
+struct SerialTypeTag<Vector<T, Alloc, Growth>> {
+    static constexpr uint32_t value = SerialTypeTag<T>::value + 0x10000;
+};
+
+struct SerialHeader {
+    static constexpr char kMagic[4] = {'V', 'S', 'E', 'R'};
+    static constexpr uint16_t kVersion = 1;
+    static constexpr uint8_t kLittleEndian = 1;
+    static constexpr uint8_t kBigEndian = 2;
+
+    char magic[4];
+    uint16_t version;
+    uint8_t endianness;
+    uint8_t reserved;
+    uint32_t type_tag;
+    // Size and alignment of the innermost element type
+    uint32_t element_size;
+    uint32_t element_alignment;
+    uint32_t reserved2;
+    uint64_t count;
+    uint64_t payload_bytes;
+    uint64_t checksum;
+    uint8_t padding[16];
+
+    static constexpr uint8_t NativeEndianness() noexcept {
+        return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? kLittleEndian : kBigEndian;
+    }
+};
+
+static_assert(sizeof(SerialHeader) == 64, "The payload starts 64 bytes into the stream");
+
+// FNV-1a over native-order 64-bit words of the byte stream. The result
+// does not depend on how the stream is split into Update calls.
+class SerialChecksum {
+public:
+    void Update(const void* data, size_t size) noexcept;
+    uint64_t Finish() const noexcept;
+
+private:
+    static constexpr uint64_t kPrime = 0x100000001b3;
+
+    void Mix(uint64_t word) noexcept { hash_ = (hash_ ^ word) * kPrime; }
+
+    uint64_t hash_ = 0xcbf29ce484222325;
+    uint64_t total_ = 0;
+    unsigned char pending_[8] = {};
+};
+
+// Read-only view of a serialized flat vector inside a caller-owned buffer
+template <typename T>
+class VectorView {
+public:
+    using const_iterator = const T*;
+
+    VectorView() = default;
+    VectorView(const T* data, size_t size) noexcept : data_(data), size_(size) {}
+
+    const T& operator[](size_t index) const noexcept {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    size_t Size() const noexcept { return size_; }
+    const_iterator begin() const noexcept { return data_; }
+    const_iterator end() const noexcept { return data_ + size_; }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// Writes `vec` to `out`. Throws std::runtime_error if the stream fails.
+template <typename T, typename Alloc, typename Growth>
+void Save(std::ostream& out, const Vector<T, Alloc, Growth>& vec);
+
+// Replaces the contents of `vec` with a vector read from `in`. Throws
+// std::runtime_error if the data is truncated, corrupt or was written for
+// another element type or byte order; `vec` is unchanged then.
+template <typename T, typename Alloc, typename Growth>
+void Load(std::istream& in, Vector<T, Alloc, Growth>& vec);
+
+// Returns a view of the vector serialized at the start of `buffer`, whose
+// payload must be suitably aligned for T (e.g. a mapped file or a buffer
+// from operator new). With `verify`, the checksum is checked as well.
+template <typename T>
+VectorView<T> View(const void* buffer, size_t size, bool verify = true);
+
+
+// Implementation of SerialChecksum class methods
+
+
+inline void SerialChecksum::Update(const void* data, size_t size) noexcept {
+    if (size == 0) {
+        return;
+    }
+    auto bytes = static_cast<const unsigned char*>(data);
+    size_t used = total_ % 8;
+    total_ += size;
+    if (used != 0) {
+        const size_t take = size < 8 - used ? size : 8 - used;
+        std::memcpy(pending_ + used, bytes, take);
+        bytes += take;
+        size -= take;
+        used += take;
+        if (used < 8) {
+            return;
+        }
+        uint64_t word;
+        std::memcpy(&word, pending_, 8);
+        Mix(word);
+    }
+    for (; size >= 8; bytes += 8, size -= 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes, 8);
+        Mix(word);
+    }
+    std::memcpy(pending_, bytes, size);
+}
+
+inline uint64_t SerialChecksum::Finish() const noexcept {
+    SerialChecksum copy = *this;
+    uint64_t tail = 0;
+    std::memcpy(&tail, copy.pending_, total_ % 8);
+    copy.Mix(tail);
+    copy.Mix(total_);
+    return copy.hash_;
+}
+
+
+// Implementation of serialization functions
+
+
+// Writes a payload to a stream, or only measures and hashes it if `out` is
+// null, so the header can be written before the payload
+class SerialWriter {
+public:
+    explicit SerialWriter(std::ostream* out) noexcept : out_(out) {}
+
+    void Write(const void* data, size_t size) {
+        checksum_.Update(data, size);
+        bytes_ += size;
+        if (out_ != nullptr && size != 0 && !out_->write(static_cast<const char*>(data), size)) {
+            throw std::runtime_error("Failed to write vector");
+        }
+    }
+
+    uint64_t Bytes() const noexcept { return bytes_; }
+    uint64_t Checksum() const noexcept { return checksum_.Finish(); }
+
+private:
+    std::ostream* out_;
+    SerialChecksum checksum_;
+    uint64_t bytes_ = 0;
+};
+
+// Reads at most `payload_bytes` bytes of payload from a stream
+class SerialReader {
+public:
+    SerialReader(std::istream& in, uint64_t payload_bytes) noexcept : in_(in), remaining_(payload_bytes) {}
+
+    void Read(void* data, size_t size) {
+        if (size > remaining_ || (size != 0 && !in_.read(static_cast<char*>(data), size))) {
+            throw std::runtime_error("Truncated vector data");
+        }
+        remaining_ -= size;
+        checksum_.Update(data, size);
+    }
+
+    uint64_t ReadLength(size_t element_size) {
+        uint64_t length;
+        Read(&length, sizeof(length));
+        // Reject lengths the remaining payload cannot hold before allocating
+        if (element_size != 0 && length > remaining_ / element_size) {
+            throw std::runtime_error("Corrupt vector length");
+        }
+        return length;
+    }
+
+    uint64_t Remaining() const noexcept { return remaining_; }
+    uint64_t Checksum() const noexcept { return checksum_.Finish(); }
+
+private:
+    std::istream& in_;
+    uint64_t remaining_;
+    SerialChecksum checksum_;
+};
+
+// Writes and reads the payload of `count` elements of type T
+template <typename T, typename = void>
+struct SerialPayload {
+    static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable types, strings and vectors are serializable");
+
+    using Leaf = T;
+    // Smallest number of payload bytes per element
+    static constexpr size_t kMinBytes = sizeof(T);
+
+    static void Write(SerialWriter& writer, const T* data, size_t count) {
+        writer.Write(data, count * sizeof(T));
+    }
+
+    template <typename Alloc, typename Growth>
+    static void Read(SerialReader& reader, Vector<T, Alloc, Growth>& vec, size_t count) {
+        if (count > reader.Remaining() / sizeof(T)) {
+            throw std::runtime_error("Truncated vector data");
+        }
+        // Default initialization leaves the bytes to the single read below
+        T* data = vec.AppendUninitialized(count);
+        reader.Read(data, count * sizeof(T));
+    }
+};
+
+template <>
+struct SerialPayload<std::string> {
+    using Leaf = char;
+    static constexpr size_t kMinBytes = sizeof(uint64_t);
+
+    static void Write(SerialWriter& writer, const std::string* data, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t length = data[i].size();
+            writer.Write(&length, sizeof(length));
+            writer.Write(data[i].data(), length);
+        }
+    }
+
+    template <typename Alloc, typename Growth>
+    static void Read(SerialReader& reader, Vector<std::string, Alloc, Growth>& vec, size_t count) {
+        vec.Reserve(vec.Size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            std::string value(reader.ReadLength(1), '\0');
+            reader.Read(value.data(), value.size());
+            vec.PushBack(std::move(value));
+        }
+    }
+};
+
+template <typename T, typename InnerAlloc, typename InnerGrowth>
+struct SerialPayload<Vector<T, InnerAlloc, InnerGrowth>> {
+    using Inner = Vector<T, InnerAlloc, InnerGrowth>;
+    using Leaf = typename SerialPayload<T>::Leaf;
+    static constexpr size_t kMinBytes = sizeof(uint64_t);
+
+    static void Write(SerialWriter& writer, const Inner* data, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const uint64_t length = data[i].Size();
+            writer.Write(&length, sizeof(length));
+            SerialPayload<T>::Write(writer, data[i].begin(), length);
+        }
+    }
+
+    template <typename Alloc, typename Growth>
+    static void Read(SerialReader& reader, Vector<Inner, Alloc, Growth>& vec, size_t count) {
+        vec.Reserve(vec.Size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            const size_t length = reader.ReadLength(SerialPayload<T>::kMinBytes);
+            Inner inner;
+            SerialPayload<T>::Read(reader, inner, length);
+            vec.PushBack(std::move(inner));
+        }
+    }
+};
+
+template <typename T>
+SerialHeader MakeSerialHeader(uint64_t count, uint64_t payload_bytes, uint64_t checksum) noexcept {
+    using Leaf = typename SerialPayload<T>::Leaf;
+    SerialHeader header = {};
+    std::memcpy(header.magic, SerialHeader::kMagic, sizeof(header.magic));
+    header.version = SerialHeader::kVersion;
+    header.endianness = SerialHeader::NativeEndianness();
+    header.type_tag = SerialTypeTag<T>::value;
+    header.element_size = sizeof(Leaf);
+    header.element_alignment = alignof(Leaf);
+    header.count = count;
+    header.payload_bytes = payload_bytes;
+    header.checksum = checksum;
+    return header;
+}
+
+// Throws unless `header` describes a vector of T written on this platform
+template <typename T>
+void CheckSerialHeader(const SerialHeader& header) {
+    const SerialHeader expected = MakeSerialHeader<T>(0, 0, 0);
+    if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error("Not a serialized vector");
+    }
+    if (header.version != expected.version) {
+        throw std::runtime_error("Unsupported vector format version " + std::to_string(header.version));
+    }
+    if (header.endianness != expected.endianness) {
+        throw std::runtime_error("Vector was written with another byte order");
+    }
+    if (header.type_tag != expected.type_tag || header.element_size != expected.element_size
+        || header.element_alignment != expected.element_alignment) {
+        throw std::runtime_error("Vector was written with another element type");
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Save(std::ostream& out, const Vector<T, Alloc, Growth>& vec) {
+    SerialWriter measure(nullptr);
+    SerialPayload<T>::Write(measure, vec.begin(), vec.Size());
+    const SerialHeader header = MakeSerialHeader<T>(vec.Size(), measure.Bytes(), measure.Checksum());
+    if (!out.write(reinterpret_cast<const char*>(&header), sizeof(header))) {
+        throw std::runtime_error("Failed to write vector");
+    }
+    SerialWriter writer(&out);
+    SerialPayload<T>::Write(writer, vec.begin(), vec.Size());
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Load(std::istream& in, Vector<T, Alloc, Growth>& vec) {
+    SerialHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        throw std::runtime_error("Truncated vector header");
+    }
+    CheckSerialHeader<T>(header);
+    if (header.count > header.payload_bytes / SerialPayload<T>::kMinBytes) {
+        throw std::runtime_error("Corrupt vector length");
+    }
+    SerialReader reader(in, header.payload_bytes);
+    // Staged with the allocator a copy would get, so that the staging buffer
+    // never shares storage with `vec`, such as the pages of a mapped file
+    Vector<T, Alloc, Growth> result(
+        std::allocator_traits<Alloc>::select_on_container_copy_construction(vec.GetAllocator()));
+    SerialPayload<T>::Read(reader, result, header.count);
+    if (reader.Remaining() != 0 || reader.Checksum() != header.checksum) {
+        throw std::runtime_error("Vector checksum mismatch");
+    }
+    vec = std::move(result);
+}
+
+template <typename T>
+VectorView<T> View(const void* buffer, size_t size, bool verify) {
+    static_assert(std::is_trivially_copyable_v<T>, "Only flat vectors can be viewed in place");
+    SerialHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Truncated vector header");
+    }
+    std::memcpy(&header, buffer, sizeof(header));
+    CheckSerialHeader<T>(header);
+    const auto* payload = static_cast<const unsigned char*>(buffer) + sizeof(header);
+    if (header.payload_bytes > size - sizeof(header) || header.count != header.payload_bytes / sizeof(T)
+        || header.payload_bytes % sizeof(T) != 0) {
+        throw std::runtime_error("Truncated vector data");
+    }
+    if (reinterpret_cast<uintptr_t>(payload) % alignof(T) != 0) {
+        throw std::runtime_error("Vector payload is misaligned for viewing");
+    }
+    if (verify) {
+        SerialChecksum checksum;
+        checksum.Update(payload, header.payload_bytes);
+        if (checksum.Finish() != header.checksum) {
+            throw std::runtime_error("Vector checksum mismatch");
+        }
+    }
+    return VectorView<T>(reinterpret_cast<const T*>(payload), header.count);
+}
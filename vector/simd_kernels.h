@@ -0,0 +1,755 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "vector.h"
+
+// Numeric kernels over contiguous ranges of arithmetic types, vectorized
+// for SSE2, AVX2 and AVX-512 and dispatched at runtime to the widest
+// instruction set the CPU supports. Every kernel also has a scalar
+// implementation, used on other architectures or when forced through
+// Simd::SetLevel.
+//
+// Integer sums and products wrap around instead of overflowing. Floating
+// point reductions reassociate, so results may differ from a sequential
+// loop by rounding. Min/Max/ArgMin/ArgMax do not support NaNs. The bitwise
+// kernels take unsigned integer types only.
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define VECTOR_SIMD_X86 1
+#else
+#define VECTOR_SIMD_X86 0
+#endif
+
+enum class SimdLevel {
+    kScalar,
+    kSse2,
+    kAvx2,
+    kAvx512,
+};
+
+class Simd {
+public:
+    // Widest level supported by the CPU
+    static SimdLevel SupportedLevel() noexcept;
+    // Level used by the kernels, SupportedLevel() unless overridden
+    static SimdLevel ActiveLevel() noexcept;
+    // Forces a level, e.g. to compare implementations. Levels the CPU does
+    // not support are clamped to SupportedLevel().
+    static void SetLevel(SimdLevel level) noexcept;
+
+    template <typename T>
+    static T Sum(const T* data, size_t size);
+    template <typename T>
+    static T Dot(const T* a, const T* b, size_t size);
+
+    // The range must not be empty. ArgMin/ArgMax return the index of the
+    // first minimum/maximum.
+    template <typename T>
+    static T Min(const T* data, size_t size);
+    template <typename T>
+    static T Max(const T* data, size_t size);
+    template <typename T>
+    static size_t ArgMin(const T* data, size_t size);
+    template <typename T>
+    static size_t ArgMax(const T* data, size_t size);
+
+    template <typename T>
+    static void Fill(T* data, size_t size, T value);
+    // data[i] *= factor
+    template <typename T>
+    static void Scale(T* data, size_t size, T factor);
+    // y[i] += a * x[i]
+    template <typename T>
+    static void Axpy(T a, const T* x, T* y, size_t size);
+    // out[i] = a[i] + b[i]; `out` may be `a` or `b`
+    template <typename T>
+    static void Add(const T* a, const T* b, T* out, size_t size);
+    // out[i] = a[i] * b[i]; `out` may be `a` or `b`
+    template <typename T>
+    static void Mul(const T* a, const T* b, T* out, size_t size);
+
+    // out[i] = a[i] & b[i], a[i] | b[i], a[i] ^ b[i]; `out` may be `a` or `b`
+    template <typename T>
+    static void And(const T* a, const T* b, T* out, size_t size);
+    template <typename T>
+    static void Or(const T* a, const T* b, T* out, size_t size);
+    template <typename T>
+    static void Xor(const T* a, const T* b, T* out, size_t size);
+    // out[i] = ~a[i]; `out` may be `a`
+    template <typename T>
+    static void Not(const T* a, T* out, size_t size);
+    // Number of set bits in `size` words
+    static size_t PopCount(const uint64_t* data, size_t size);
+
+    // Overloads for whole vectors. Binary kernels require equal sizes.
+    template <typename T, typename A, typename G>
+    static T Sum(const Vector<T, A, G>& v) { return Sum(v.begin(), v.Size()); }
+    template <typename T, typename A, typename G>
+    static T Dot(const Vector<T, A, G>& a, const Vector<T, A, G>& b);
+    template <typename T, typename A, typename G>
+    static T Min(const Vector<T, A, G>& v) { return Min(v.begin(), v.Size()); }
+    template <typename T, typename A, typename G>
+    static T Max(const Vector<T, A, G>& v) { return Max(v.begin(), v.Size()); }
+    template <typename T, typename A, typename G>
+    static size_t ArgMin(const Vector<T, A, G>& v) { return ArgMin(v.begin(), v.Size()); }
+    template <typename T, typename A, typename G>
+    static size_t ArgMax(const Vector<T, A, G>& v) { return ArgMax(v.begin(), v.Size()); }
+    template <typename T, typename A, typename G>
+    static void Fill(Vector<T, A, G>& v, T value) { Fill(v.begin(), v.Size(), value); }
+    template <typename T, typename A, typename G>
+    static void Scale(Vector<T, A, G>& v, T factor) { Scale(v.begin(), v.Size(), factor); }
+    template <typename T, typename A, typename G>
+    static void Axpy(T a, const Vector<T, A, G>& x, Vector<T, A, G>& y);
+    template <typename T, typename A, typename G>
+    static void Add(const Vector<T, A, G>& a, const Vector<T, A, G>& b, Vector<T, A, G>& out);
+    template <typename T, typename A, typename G>
+    static void Mul(const Vector<T, A, G>& a, const Vector<T, A, G>& b, Vector<T, A, G>& out);
+
+private:
+    template <typename T>
+    static constexpr void CheckType() noexcept {
+        static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, "Simd kernels need an arithmetic type");
+    }
+
+    template <typename T>
+    static constexpr void CheckBitwiseType() noexcept {
+        static_assert(std::is_unsigned_v<T> && !std::is_same_v<T, bool>, "Bitwise kernels need an unsigned type");
+    }
+
+    static std::atomic<SimdLevel>& Level() noexcept;
+
+    // Calls `kernel(Kernels{})` with the kernel set of the active level
+    template <typename Kernel>
+    static decltype(auto) Dispatch(Kernel&& kernel);
+};
+
+// Lane type used for arithmetic: integers are processed as unsigned so
+// that sums and products wrap. Scalar code uses `scalar` instead, since
+// lanes narrower than unsigned int would promote to int, where products
+// such as 65535 * 65535 overflow.
+template <typename T, bool = std::is_integral_v<T>>
+struct SimdLane {
+    using type = T;
+    using scalar = T;
+};
+
+template <typename T>
+struct SimdLane<T, true> {
+    using type = std::make_unsigned_t<T>;
+    using scalar = std::common_type_t<type, unsigned>;
+};
+
+// Scalar reference implementations
+struct SimdScalarKernels {
+    template <typename T>
+    using Lane = typename SimdLane<T>::scalar;
+
+    template <typename T>
+    static T Sum(const T* data, size_t size) noexcept {
+        Lane<T> sum = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += Lane<T>(data[i]);
+        }
+        return T(sum);
+    }
+
+    template <typename T>
+    static T Dot(const T* a, const T* b, size_t size) noexcept {
+        Lane<T> sum = 0;
+        for (size_t i = 0; i < size; ++i) {
+            sum += Lane<T>(a[i]) * Lane<T>(b[i]);
+        }
+        return T(sum);
+    }
+
+    template <typename T>
+    static size_t ArgMin(const T* data, size_t size) noexcept {
+        size_t best = 0;
+        for (size_t i = 1; i < size; ++i) {
+            best = data[i] < data[best] ? i : best;
+        }
+        return best;
+    }
+
+    template <typename T>
+    static size_t ArgMax(const T* data, size_t size) noexcept {
+        size_t best = 0;
+        for (size_t i = 1; i < size; ++i) {
+            best = data[best] < data[i] ? i : best;
+        }
+        return best;
+    }
+
+    template <typename T>
+    static T Min(const T* data, size_t size) noexcept { return data[ArgMin(data, size)]; }
+    template <typename T>
+    static T Max(const T* data, size_t size) noexcept { return data[ArgMax(data, size)]; }
+
+    template <typename T>
+    static void Fill(T* data, size_t size, T value) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = value;
+        }
+    }
+
+    template <typename T>
+    static void Scale(T* data, size_t size, T factor) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = T(Lane<T>(data[i]) * Lane<T>(factor));
+        }
+    }
+
+    template <typename T>
+    static void Axpy(T a, const T* x, T* y, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            y[i] = T(Lane<T>(y[i]) + Lane<T>(a) * Lane<T>(x[i]));
+        }
+    }
+
+    template <typename T>
+    static void Add(const T* a, const T* b, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = T(Lane<T>(a[i]) + Lane<T>(b[i]));
+        }
+    }
+
+    template <typename T>
+    static void Mul(const T* a, const T* b, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = T(Lane<T>(a[i]) * Lane<T>(b[i]));
+        }
+    }
+
+    template <typename T>
+    static void And(const T* a, const T* b, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = a[i] & b[i];
+        }
+    }
+
+    template <typename T>
+    static void Or(const T* a, const T* b, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = a[i] | b[i];
+        }
+    }
+
+    template <typename T>
+    static void Xor(const T* a, const T* b, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = a[i] ^ b[i];
+        }
+    }
+
+    template <typename T>
+    static void Not(const T* a, T* out, size_t size) noexcept {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = T(~a[i]);
+        }
+    }
+
+    static size_t PopCount(const uint64_t* data, size_t size) noexcept {
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i) {
+            count += __builtin_popcountll(data[i]);
+        }
+        return count;
+    }
+};
+
+#if VECTOR_SIMD_X86
+
+// Kernels over `Bytes`-wide GCC vector extension types. They carry no
+// target attribute of their own: they are force-inlined into the
+// per-ISA wrappers below, which compile them for SSE2, AVX2 or AVX-512.
+template <typename T, size_t Bytes>
+struct SimdBlockKernels {
+    using Lane = typename SimdLane<T>::type;
+    // Type for the scalar tails
+    using Scalar = typename SimdLane<T>::scalar;
+    typedef Lane Wrapping __attribute__((vector_size(Bytes)));
+    typedef T Ordered __attribute__((vector_size(Bytes)));
+    static constexpr size_t kLanes = Bytes / sizeof(T);
+
+    __attribute__((always_inline)) static T Sum(const T* data, size_t size) noexcept {
+        Wrapping acc0{}, acc1{}, acc2{}, acc3{};
+        size_t i = 0;
+        for (; i + 4 * kLanes <= size; i += 4 * kLanes) {
+            Wrapping v0, v1, v2, v3;
+            std::memcpy(&v0, data + i, Bytes);
+            std::memcpy(&v1, data + i + kLanes, Bytes);
+            std::memcpy(&v2, data + i + 2 * kLanes, Bytes);
+            std::memcpy(&v3, data + i + 3 * kLanes, Bytes);
+            acc0 += v0;
+            acc1 += v1;
+            acc2 += v2;
+            acc3 += v3;
+        }
+        for (; i + kLanes <= size; i += kLanes) {
+            Wrapping v;
+            std::memcpy(&v, data + i, Bytes);
+            acc0 += v;
+        }
+        const Wrapping acc = (acc0 + acc1) + (acc2 + acc3);
+        Scalar sum = 0;
+        for (size_t k = 0; k < kLanes; ++k) {
+            sum += acc[k];
+        }
+        for (; i < size; ++i) {
+            sum += Scalar(Lane(data[i]));
+        }
+        return T(sum);
+    }
+
+    __attribute__((always_inline)) static T Dot(const T* a, const T* b, size_t size) noexcept {
+        Wrapping acc0{}, acc1{};
+        size_t i = 0;
+        for (; i + 2 * kLanes <= size; i += 2 * kLanes) {
+            Wrapping a0, a1, b0, b1;
+            std::memcpy(&a0, a + i, Bytes);
+            std::memcpy(&a1, a + i + kLanes, Bytes);
+            std::memcpy(&b0, b + i, Bytes);
+            std::memcpy(&b1, b + i + kLanes, Bytes);
+            acc0 += a0 * b0;
+            acc1 += a1 * b1;
+        }
+        for (; i + kLanes <= size; i += kLanes) {
+            Wrapping va, vb;
+            std::memcpy(&va, a + i, Bytes);
+            std::memcpy(&vb, b + i, Bytes);
+            acc0 += va * vb;
+        }
+        const Wrapping acc = acc0 + acc1;
+        Scalar sum = 0;
+        for (size_t k = 0; k < kLanes; ++k) {
+            sum += acc[k];
+        }
+        for (; i < size; ++i) {
+            sum += Scalar(Lane(a[i])) * Scalar(Lane(b[i]));
+        }
+        return T(sum);
+    }
+
+    // Min and Max are idempotent, so the tail is handled by one last block
+    // overlapping the previous ones
+    template <bool kMax>
+    __attribute__((always_inline)) static T Extremum(const T* data, size_t size) noexcept {
+        assert(size > 0);
+        if (size < kLanes) {
+            return kMax ? SimdScalarKernels::Max(data, size) : SimdScalarKernels::Min(data, size);
+        }
+        Ordered best;
+        std::memcpy(&best, data, Bytes);
+        for (size_t i = kLanes;; i += kLanes) {
+            Ordered v;
+            std::memcpy(&v, data + (i + kLanes <= size ? i : size - kLanes), Bytes);
+            best = (kMax ? best < v : v < best) ? v : best;
+            if (i + kLanes >= size) {
+                break;
+            }
+        }
+        T result = best[0];
+        for (size_t k = 1; k < kLanes; ++k) {
+            result = (kMax ? result < best[k] : best[k] < result) ? best[k] : result;
+        }
+        return result;
+    }
+
+    // Index of the first element equal to `value`, or `size`
+    __attribute__((always_inline)) static size_t Find(const T* data, size_t size, T value) noexcept {
+        const Ordered needle = Ordered{} + value;
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            Ordered v;
+            std::memcpy(&v, data + i, Bytes);
+            const auto equal = v == needle;
+            bool any = false;
+            for (size_t k = 0; k < kLanes; ++k) {
+                any |= equal[k] != 0;
+            }
+            if (any) {
+                break;
+            }
+        }
+        for (; i < size && data[i] != value; ++i) {
+        }
+        return i;
+    }
+
+    __attribute__((always_inline)) static void Fill(T* data, size_t size, T value) noexcept {
+        const Ordered v = Ordered{} + value;
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            std::memcpy(data + i, &v, Bytes);
+        }
+        for (; i < size; ++i) {
+            data[i] = value;
+        }
+    }
+
+    enum class Op { kAdd, kMul, kScale, kAxpy, kAnd, kOr, kXor, kNot };
+
+    // out[i] = a[i] + b[i], a[i] * b[i], a[i] * factor, b[i] + factor * a[i]
+    // or a bitwise a[i] & b[i], a[i] | b[i], a[i] ^ b[i], ~a[i]
+    template <Op kOp>
+    __attribute__((always_inline)) static void Map(const T* a, const T* b, T* out, size_t size, T factor) noexcept {
+        const Lane f = Lane(factor);
+        size_t i = 0;
+        for (; i + kLanes <= size; i += kLanes) {
+            Wrapping va, vb, result;
+            std::memcpy(&va, a + i, Bytes);
+            std::memcpy(&vb, b + i, Bytes);
+            if constexpr (kOp == Op::kAdd) {
+                result = va + vb;
+            } else if constexpr (kOp == Op::kMul) {
+                result = va * vb;
+            } else if constexpr (kOp == Op::kScale) {
+                result = va * f;
+            } else if constexpr (kOp == Op::kAxpy) {
+                result = vb + f * va;
+            } else if constexpr (kOp == Op::kAnd) {
+                result = va & vb;
+            } else if constexpr (kOp == Op::kOr) {
+                result = va | vb;
+            } else if constexpr (kOp == Op::kXor) {
+                result = va ^ vb;
+            } else {
+                result = ~va;
+            }
+            std::memcpy(out + i, &result, Bytes);
+        }
+        const Scalar sf = f;
+        for (; i < size; ++i) {
+            const Scalar la = Lane(a[i]);
+            const Scalar lb = Lane(b[i]);
+            if constexpr (kOp == Op::kAdd) {
+                out[i] = T(la + lb);
+            } else if constexpr (kOp == Op::kMul) {
+                out[i] = T(la * lb);
+            } else if constexpr (kOp == Op::kScale) {
+                out[i] = T(la * sf);
+            } else if constexpr (kOp == Op::kAxpy) {
+                out[i] = T(lb + sf * la);
+            } else if constexpr (kOp == Op::kAnd) {
+                out[i] = T(la & lb);
+            } else if constexpr (kOp == Op::kOr) {
+                out[i] = T(la | lb);
+            } else if constexpr (kOp == Op::kXor) {
+                out[i] = T(la ^ lb);
+            } else {
+                out[i] = T(~la);
+            }
+        }
+    }
+
+    __attribute__((always_inline)) static void Scale(T* data, size_t size, T factor) noexcept {
+        Map<Op::kScale>(data, data, data, size, factor);
+    }
+
+    __attribute__((always_inline)) static void Axpy(T a, const T* x, T* y, size_t size) noexcept {
+        Map<Op::kAxpy>(x, y, y, size, a);
+    }
+
+    __attribute__((always_inline)) static void Add(const T* a, const T* b, T* out, size_t size) noexcept {
+        Map<Op::kAdd>(a, b, out, size, T());
+    }
+
+    __attribute__((always_inline)) static void Mul(const T* a, const T* b, T* out, size_t size) noexcept {
+        Map<Op::kMul>(a, b, out, size, T());
+    }
+
+    __attribute__((always_inline)) static void And(const T* a, const T* b, T* out, size_t size) noexcept {
+        Map<Op::kAnd>(a, b, out, size, T());
+    }
+
+    __attribute__((always_inline)) static void Or(const T* a, const T* b, T* out, size_t size) noexcept {
+        Map<Op::kOr>(a, b, out, size, T());
+    }
+
+    __attribute__((always_inline)) static void Xor(const T* a, const T* b, T* out, size_t size) noexcept {
+        Map<Op::kXor>(a, b, out, size, T());
+    }
+
+    __attribute__((always_inline)) static void Not(const T* a, T* out, size_t size) noexcept {
+        Map<Op::kNot>(a, a, out, size, T());
+    }
+};
+
+// Counts bits with four independent accumulators, so that the popcnt
+// instruction, where the target has it, is not bound by one dependency chain
+__attribute__((always_inline)) inline size_t SimdPopCount(const uint64_t* data, size_t size) noexcept {
+    size_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        c0 += __builtin_popcountll(data[i]);
+        c1 += __builtin_popcountll(data[i + 1]);
+        c2 += __builtin_popcountll(data[i + 2]);
+        c3 += __builtin_popcountll(data[i + 3]);
+    }
+    for (; i < size; ++i) {
+        c0 += __builtin_popcountll(data[i]);
+    }
+    return (c0 + c1) + (c2 + c3);
+}
+
+// Instantiates SimdBlockKernels for one instruction set. The AVX2 and
+// AVX-512 sets also use popcnt, which every CPU with AVX2 has.
+#define VECTOR_SIMD_DEFINE_KERNELS(Name, Target, Bytes)                                                  \
+    struct Name {                                                                                       \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static T Sum(const T* data, size_t size) noexcept {             \
+            return SimdBlockKernels<T, Bytes>::Sum(data, size);                                         \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static T Dot(const T* a, const T* b, size_t size) noexcept {    \
+            return SimdBlockKernels<T, Bytes>::Dot(a, b, size);                                         \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static T Min(const T* data, size_t size) noexcept {             \
+            return SimdBlockKernels<T, Bytes>::template Extremum<false>(data, size);                    \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static T Max(const T* data, size_t size) noexcept {             \
+            return SimdBlockKernels<T, Bytes>::template Extremum<true>(data, size);                     \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static size_t ArgMin(const T* data, size_t size) noexcept {     \
+            return SimdBlockKernels<T, Bytes>::Find(data, size, Min(data, size));                       \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static size_t ArgMax(const T* data, size_t size) noexcept {     \
+            return SimdBlockKernels<T, Bytes>::Find(data, size, Max(data, size));                       \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Fill(T* data, size_t size, T value) noexcept {      \
+            SimdBlockKernels<T, Bytes>::Fill(data, size, value);                                        \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Scale(T* data, size_t size, T factor) noexcept {    \
+            SimdBlockKernels<T, Bytes>::Scale(data, size, factor);                                      \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Axpy(T a, const T* x, T* y, size_t size) noexcept { \
+            SimdBlockKernels<T, Bytes>::Axpy(a, x, y, size);                                            \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Add(const T* a, const T* b, T* out,                 \
+                                                        size_t size) noexcept {                         \
+            SimdBlockKernels<T, Bytes>::Add(a, b, out, size);                                           \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Mul(const T* a, const T* b, T* out,                 \
+                                                        size_t size) noexcept {                         \
+            SimdBlockKernels<T, Bytes>::Mul(a, b, out, size);                                           \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void And(const T* a, const T* b, T* out,                 \
+                                                        size_t size) noexcept {                         \
+            SimdBlockKernels<T, Bytes>::And(a, b, out, size);                                           \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Or(const T* a, const T* b, T* out,                  \
+                                                       size_t size) noexcept {                          \
+            SimdBlockKernels<T, Bytes>::Or(a, b, out, size);                                            \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Xor(const T* a, const T* b, T* out,                 \
+                                                        size_t size) noexcept {                         \
+            SimdBlockKernels<T, Bytes>::Xor(a, b, out, size);                                           \
+        }                                                                                               \
+        template <typename T>                                                                           \
+        __attribute__((target(Target))) static void Not(const T* a, T* out, size_t size) noexcept {     \
+            SimdBlockKernels<T, Bytes>::Not(a, out, size);                                              \
+        }                                                                                               \
+        __attribute__((target(Target))) static size_t PopCount(const uint64_t* data,                    \
+                                                              size_t size) noexcept {                   \
+            return SimdPopCount(data, size);                                                            \
+        }                                                                                               \
+    };
+
+VECTOR_SIMD_DEFINE_KERNELS(SimdSse2Kernels, "sse2", 16)
+VECTOR_SIMD_DEFINE_KERNELS(SimdAvx2Kernels, "avx2,popcnt", 32)
+VECTOR_SIMD_DEFINE_KERNELS(SimdAvx512Kernels, "avx512f,popcnt", 64)
+
+#undef VECTOR_SIMD_DEFINE_KERNELS
+
+#endif  // VECTOR_SIMD_X86
+
+
+// Implementation of Simd class methods
+
+
+inline SimdLevel Simd::SupportedLevel() noexcept {
+#if VECTOR_SIMD_X86
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::kAvx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::kAvx2;
+        }
+        return SimdLevel::kSse2;
+    }();
+    return level;
+#else
+    return SimdLevel::kScalar;
+#endif
+}
+
+inline std::atomic<SimdLevel>& Simd::Level() noexcept {
+    static std::atomic<SimdLevel> level(SupportedLevel());
+    return level;
+}
+
+inline SimdLevel Simd::ActiveLevel() noexcept {
+    return Level().load(std::memory_order_relaxed);
+}
+
+inline void Simd::SetLevel(SimdLevel level) noexcept {
+    Level().store(level < SupportedLevel() ? level : SupportedLevel(), std::memory_order_relaxed);
+}
+
+template <typename Kernel>
+decltype(auto) Simd::Dispatch(Kernel&& kernel) {
+    switch (ActiveLevel()) {
+#if VECTOR_SIMD_X86
+    case SimdLevel::kAvx512:
+        return kernel(SimdAvx512Kernels{});
+    case SimdLevel::kAvx2:
+        return kernel(SimdAvx2Kernels{});
+    case SimdLevel::kSse2:
+        return kernel(SimdSse2Kernels{});
+#endif
+    default:
+        return kernel(SimdScalarKernels{});
+    }
+}
+
+template <typename T>
+T Simd::Sum(const T* data, size_t size) {
+    CheckType<T>();
+    return Dispatch([&](auto kernels) { return decltype(kernels)::Sum(data, size); });
+}
+
+template <typename T>
+T Simd::Dot(const T* a, const T* b, size_t size) {
+    CheckType<T>();
+    return Dispatch([&](auto kernels) { return decltype(kernels)::Dot(a, b, size); });
+}
+
+template <typename T>
+T Simd::Min(const T* data, size_t size) {
+    CheckType<T>();
+    assert(size > 0);
+    return Dispatch([&](auto kernels) { return decltype(kernels)::Min(data, size); });
+}
+
+template <typename T>
+T Simd::Max(const T* data, size_t size) {
+    CheckType<T>();
+    assert(size > 0);
+    return Dispatch([&](auto kernels) { return decltype(kernels)::Max(data, size); });
+}
+
+template <typename T>
+size_t Simd::ArgMin(const T* data, size_t size) {
+    CheckType<T>();
+    assert(size > 0);
+    return Dispatch([&](auto kernels) { return decltype(kernels)::ArgMin(data, size); });
+}
+
+template <typename T>
+size_t Simd::ArgMax(const T* data, size_t size) {
+    CheckType<T>();
+    assert(size > 0);
+    return Dispatch([&](auto kernels) { return decltype(kernels)::ArgMax(data, size); });
+}
+
+template <typename T>
+void Simd::Fill(T* data, size_t size, T value) {
+    CheckType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Fill(data, size, value); });
+}
+
+template <typename T>
+void Simd::Scale(T* data, size_t size, T factor) {
+    CheckType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Scale(data, size, factor); });
+}
+
+template <typename T>
+void Simd::Axpy(T a, const T* x, T* y, size_t size) {
+    CheckType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Axpy(a, x, y, size); });
+}
+
+template <typename T>
+void Simd::Add(const T* a, const T* b, T* out, size_t size) {
+    CheckType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Add(a, b, out, size); });
+}
+
+template <typename T>
+void Simd::Mul(const T* a, const T* b, T* out, size_t size) {
+    CheckType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Mul(a, b, out, size); });
+}
+
+template <typename T>
+void Simd::And(const T* a, const T* b, T* out, size_t size) {
+    CheckBitwiseType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::And(a, b, out, size); });
+}
+
+template <typename T>
+void Simd::Or(const T* a, const T* b, T* out, size_t size) {
+    CheckBitwiseType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Or(a, b, out, size); });
+}
+
+template <typename T>
+void Simd::Xor(const T* a, const T* b, T* out, size_t size) {
+    CheckBitwiseType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Xor(a, b, out, size); });
+}
+
+template <typename T>
+void Simd::Not(const T* a, T* out, size_t size) {
+    CheckBitwiseType<T>();
+    Dispatch([&](auto kernels) { decltype(kernels)::Not(a, out, size); });
+}
+
+inline size_t Simd::PopCount(const uint64_t* data, size_t size) {
+    return Dispatch([&](auto kernels) { return decltype(kernels)::PopCount(data, size); });
+}
+
+template <typename T, typename A, typename G>
+T Simd::Dot(const Vector<T, A, G>& a, const Vector<T, A, G>& b) {
+    assert(a.Size() == b.Size());
+    return Dot(a.begin(), b.begin(), a.Size());
+}
+
+template <typename T, typename A, typename G>
+void Simd::Axpy(T a, const Vector<T, A, G>& x, Vector<T, A, G>& y) {
+    assert(x.Size() == y.Size());
+    Axpy(a, x.begin(), y.begin(), x.Size());
+}
+
+template <typename T, typename A, typename G>
+void Simd::Add(const Vector<T, A, G>& a, const Vector<T, A, G>& b, Vector<T, A, G>& out) {
+    assert(a.Size() == b.Size() && a.Size() == out.Size());
+    Add(a.begin(), b.begin(), out.begin(), a.Size());
+}
+
+template <typename T, typename A, typename G>
+void Simd::Mul(const Vector<T, A, G>& a, const Vector<T, A, G>& b, Vector<T, A, G>& out) {
+    assert(a.Size() == b.Size() && a.Size() == out.Size());
+    Mul(a.begin(), b.begin(), out.begin(), a.Size());
+}
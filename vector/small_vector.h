@@ -0,0 +1,383 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "raw_memory.h"
+#include "relocation.h"
+
+// SmallVector keeps up to `N` elements inside the object itself and only
+// spills to a heap `RawMemory` buffer once that inline storage overflows.
+// The interface and exception guarantees mirror `Vector`.
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(N > 0, "SmallVector needs at least one inline element");
+
+public:
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() noexcept = default;
+    explicit SmallVector(size_t size);
+    SmallVector(const SmallVector& other);
+    SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    SmallVector& operator=(const SmallVector& rhs);
+    SmallVector& operator=(SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    void Swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    // Resizes the vector to contain `new_size` elements
+    void Resize(size_t new_size);
+
+    // Ensures that the vector has at least `new_capacity` storage capacity.
+    // Capacities up to `N` never allocate.
+    void Reserve(size_t new_capacity);
+
+    iterator Erase(const_iterator pos);
+    void PopBack();
+
+    template <typename V>
+    void PushBack(V&& value);
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args);
+
+    template <typename... Args>
+    iterator Emplace(const_iterator pos, Args&&... args);
+
+    template <typename V>
+    iterator Insert(const_iterator pos, V&& value);
+
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+
+    size_t Size() const noexcept { return size_; }
+    size_t Capacity() const noexcept { return IsInline() ? N : heap_.Capacity(); }
+
+    // True while the elements live in the inline buffer
+    bool IsInline() const noexcept { return heap_.GetAddress() == nullptr; }
+
+    iterator begin() noexcept;
+    iterator end() noexcept;
+    const_iterator begin() const noexcept;
+    const_iterator end() const noexcept;
+    const_iterator cbegin() const noexcept;
+    const_iterator cend() const noexcept;
+
+    ~SmallVector();
+
+private:
+    alignas(T) std::byte inline_[N * sizeof(T)];
+    RawMemory<T> heap_;
+    size_t size_ = 0;
+
+    T* Data() noexcept;
+    const T* Data() const noexcept;
+
+    // Destroys all elements and returns to the inline buffer
+    void Clear() noexcept;
+
+    // Takes over the elements of `other`, leaving it empty
+    void StealFrom(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>);
+
+    // Internal helper for uninitialized memory copy or move
+    static void UninitializedMoveOrCopy(T* from, size_t number_of_elements, T* to);
+
+    // Helper for `Emplace` method with reallocation
+    template <typename... Args>
+    void EmplaceWithReallocation(const_iterator pos, Args&&... args);
+
+    // Helper for `Emplace` method without reallocation
+    template <typename... Args>
+    void EmplaceWithoutReallocation(const_iterator pos, Args&&... args);
+};
+
+
+// Implementation of SmallVector class template methods
+
+
+template <typename T, size_t N>
+SmallVector<T, N>::SmallVector(size_t size) {
+    Reserve(size);
+    std::uninitialized_value_construct_n(Data(), size);
+    size_ = size;
+}
+
+template <typename T, size_t N>
+SmallVector<T, N>::SmallVector(const SmallVector& other) {
+    Reserve(other.size_);
+    std::uninitialized_copy_n(other.Data(), other.size_, Data());
+    size_ = other.size_;
+}
+
+template <typename T, size_t N>
+SmallVector<T, N>::SmallVector(SmallVector&& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    StealFrom(other);
+}
+
+template <typename T, size_t N>
+SmallVector<T, N>& SmallVector<T, N>::operator=(const SmallVector& rhs) {
+    if (this != &rhs) {
+        if (rhs.size_ > Capacity()) {
+            RawMemory<T> new_data(rhs.size_);
+            std::uninitialized_copy_n(rhs.Data(), rhs.size_, new_data.GetAddress());
+            std::destroy_n(Data(), size_);
+            heap_.Swap(new_data);
+        } else {
+            std::copy_n(rhs.Data(), std::min(size_, rhs.size_), Data());
+            if (rhs.size_ < size_) {
+                std::destroy_n(Data() + rhs.size_, size_ - rhs.size_);
+            } else {
+                std::uninitialized_copy_n(rhs.Data() + size_, rhs.size_ - size_, Data() + size_);
+            }
+        }
+        size_ = rhs.size_;
+    }
+    return *this;
+}
+
+template <typename T, size_t N>
+SmallVector<T, N>& SmallVector<T, N>::operator=(SmallVector&& rhs) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this != &rhs) {
+        Clear();
+        StealFrom(rhs);
+    }
+    return *this;
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::Swap(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (this == &other) {
+        return;
+    }
+    if (!IsInline() && !other.IsInline()) {
+        heap_.Swap(other.heap_);
+        std::swap(size_, other.size_);
+        return;
+    }
+    SmallVector tmp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(tmp);
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::Resize(size_t new_size) {
+    if (size_ == new_size) return;
+    if (new_size < size_) {
+        std::destroy_n(Data() + new_size, size_ - new_size);
+    } else {
+        Reserve(new_size);
+        std::uninitialized_value_construct_n(Data() + size_, new_size - size_);
+    }
+    size_ = new_size;
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::Reserve(size_t new_capacity) {
+    if (new_capacity <= Capacity()) {
+        return;
+    }
+    RawMemory<T> new_data(new_capacity);
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        TrivialRelocate(Data(), size_, new_data.GetAddress());
+    } else {
+        UninitializedMoveOrCopy(Data(), size_, new_data.GetAddress());
+        std::destroy_n(Data(), size_);
+    }
+    heap_.Swap(new_data);
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::iterator SmallVector<T, N>::Erase(const_iterator pos) {
+    auto distance = std::distance(cbegin(), pos);
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        std::destroy_at(begin() + distance);
+        TrivialRelocateOverlapping(begin() + distance + 1, size_ - distance - 1, begin() + distance);
+        --size_;
+        return begin() + distance;
+    }
+    std::move(begin() + distance + 1, end(), begin() + distance);
+    PopBack();
+    return begin() + distance;
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::PopBack() {
+    assert(size_ > 0);
+    std::destroy_at(Data() + size_ - 1);
+    --size_;
+}
+
+template <typename T, size_t N>
+template <typename V>
+void SmallVector<T, N>::PushBack(V&& value) {
+    EmplaceBack(std::forward<V>(value));
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+T& SmallVector<T, N>::EmplaceBack(Args&&... args) {
+    return *Emplace(cend(), std::forward<Args>(args)...);
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+typename SmallVector<T, N>::iterator SmallVector<T, N>::Emplace(const_iterator pos, Args&&... args) {
+    auto distance = std::distance(cbegin(), pos);
+    if (size_ == Capacity()) {
+        EmplaceWithReallocation(pos, std::forward<Args>(args)...);
+    } else {
+        EmplaceWithoutReallocation(pos, std::forward<Args>(args)...);
+    }
+    ++size_;
+    return begin() + distance;
+}
+
+template <typename T, size_t N>
+template <typename V>
+typename SmallVector<T, N>::iterator SmallVector<T, N>::Insert(const_iterator pos, V&& value) {
+    return Emplace(pos, std::forward<V>(value));
+}
+
+template <typename T, size_t N>
+const T& SmallVector<T, N>::operator[](size_t index) const noexcept {
+    return const_cast<SmallVector&>(*this)[index];
+}
+
+template <typename T, size_t N>
+T& SmallVector<T, N>::operator[](size_t index) noexcept {
+    assert(index < size_);
+    return Data()[index];
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::iterator SmallVector<T, N>::begin() noexcept {
+    return Data();
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::iterator SmallVector<T, N>::end() noexcept {
+    return Data() + size_;
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::const_iterator SmallVector<T, N>::begin() const noexcept {
+    return Data();
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::const_iterator SmallVector<T, N>::end() const noexcept {
+    return Data() + size_;
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::const_iterator SmallVector<T, N>::cbegin() const noexcept {
+    return Data();
+}
+
+template <typename T, size_t N>
+typename SmallVector<T, N>::const_iterator SmallVector<T, N>::cend() const noexcept {
+    return Data() + size_;
+}
+
+template <typename T, size_t N>
+SmallVector<T, N>::~SmallVector() {
+    std::destroy_n(Data(), size_);
+}
+
+template <typename T, size_t N>
+T* SmallVector<T, N>::Data() noexcept {
+    return IsInline() ? std::launder(reinterpret_cast<T*>(inline_)) : heap_.GetAddress();
+}
+
+template <typename T, size_t N>
+const T* SmallVector<T, N>::Data() const noexcept {
+    return const_cast<SmallVector&>(*this).Data();
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::Clear() noexcept {
+    std::destroy_n(Data(), size_);
+    size_ = 0;
+    RawMemory<T> released;
+    heap_.Swap(released);
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::StealFrom(SmallVector& other) noexcept(std::is_nothrow_move_constructible_v<T>) {
+    if (other.IsInline()) {
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            TrivialRelocate(other.Data(), other.size_, Data());
+            size_ = std::exchange(other.size_, 0);
+        } else {
+            UninitializedMoveOrCopy(other.Data(), other.size_, Data());
+            size_ = other.size_;
+            other.Clear();
+        }
+    } else {
+        heap_.Swap(other.heap_);
+        size_ = std::exchange(other.size_, 0);
+    }
+}
+
+template <typename T, size_t N>
+void SmallVector<T, N>::UninitializedMoveOrCopy(T* from, size_t number_of_elements, T* to) {
+    if constexpr (std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {
+        std::uninitialized_move_n(from, number_of_elements, to);
+    } else {
+        std::uninitialized_copy_n(from, number_of_elements, to);
+    }
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+void SmallVector<T, N>::EmplaceWithReallocation(const_iterator pos, Args&&... args) {
+    auto distance = std::distance(cbegin(), pos);
+    RawMemory<T> new_data(size_ * 2);
+    new (new_data + distance) T(std::forward<Args>(args)...);
+
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        TrivialRelocate(begin(), distance, new_data.GetAddress());
+        TrivialRelocate(begin() + distance, size_ - distance, new_data.GetAddress() + distance + 1);
+        heap_.Swap(new_data);
+        return;
+    }
+    try {
+        UninitializedMoveOrCopy(begin(), distance, new_data.GetAddress());
+    } catch (...) {
+        std::destroy_n(new_data.GetAddress() + distance, 1);
+        throw;
+    }
+    try {
+        UninitializedMoveOrCopy(begin() + distance, size_ - distance, new_data.GetAddress() + distance + 1);
+    } catch (...) {
+        std::destroy_n(new_data.GetAddress(), distance + 1);
+        throw;
+    }
+    std::destroy_n(Data(), size_);
+    heap_.Swap(new_data);
+}
+
+template <typename T, size_t N>
+template <typename... Args>
+void SmallVector<T, N>::EmplaceWithoutReallocation(const_iterator pos, Args&&... args) {
+    auto distance = std::distance(cbegin(), pos);
+    if (pos == cend()) {
+        new (Data() + size_) T(std::forward<Args>(args)...);
+    } else if constexpr (kIsTriviallyRelocatable<T>) {
+        alignas(T) std::byte tmp[sizeof(T)];
+        T* value = new (tmp) T(std::forward<Args>(args)...);
+        TrivialRelocateOverlapping(Data() + distance, size_ - distance, Data() + distance + 1);
+        TrivialRelocate(value, 1, Data() + distance);
+    } else {
+        T tmp(std::forward<Args>(args)...);
+        std::uninitialized_move_n(Data() + size_ - 1, 1, Data() + size_);
+        std::move_backward(Data() + distance, end() - 1, end());
+        Data()[distance] = std::move(tmp);
+    }
+}
@@ -0,0 +1,553 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "growth_policy.h"
+#include "raw_memory.h"
+#include "relocation.h"
+
+// Contiguous view of one column of an SoAVector. It stays valid until the
+// vector reallocates or changes size.
+template <typename T>
+class ColumnSpan {
+public:
+    using iterator = T*;
+
+    ColumnSpan() = default;
+    ColumnSpan(T* data, size_t size) noexcept : data_(data), size_(size) {}
+
+    T& operator[](size_t index) const noexcept {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    T* Data() const noexcept { return data_; }
+    size_t Size() const noexcept { return size_; }
+    iterator begin() const noexcept { return data_; }
+    iterator end() const noexcept { return data_ + size_; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+// SoAVector stores rows of fields `Ts...` as a structure of arrays: each
+// field lives in its own RawMemory column, and all columns share one size
+// and capacity. A scan over one field touches only that field's bytes, and
+// Column<I>() hands it out as a contiguous span for Simd kernels.
+//
+// Rows are accessed through proxy references: soa[i].Get<I>() is the I-th
+// field of row i. Growth follows DefaultGrowth, sized by the whole row.
+template <typename... Ts>
+class SoAVector {
+    static_assert(sizeof...(Ts) > 0, "SoAVector needs at least one field");
+
+    template <bool IsConst>
+    class RowRef;
+    template <bool IsConst>
+    class Iterator;
+
+public:
+    using value_type = std::tuple<Ts...>;
+    using reference = RowRef<false>;
+    using const_reference = RowRef<true>;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    template <size_t I>
+    using Field = std::tuple_element_t<I, value_type>;
+
+    SoAVector() = default;
+    explicit SoAVector(size_t size);
+    SoAVector(const SoAVector& other);
+    SoAVector(SoAVector&& other) noexcept;
+
+    SoAVector& operator=(const SoAVector& rhs);
+    SoAVector& operator=(SoAVector&& rhs) noexcept;
+
+    void Swap(SoAVector& other) noexcept;
+
+    // Resizes the vector to `new_size` rows, value-initializing new fields
+    void Resize(size_t new_size);
+
+    // Ensures capacity for `new_capacity` rows in every column
+    void Reserve(size_t new_capacity);
+
+    // Appends a row whose fields are constructed from `args`, one argument
+    // per field, or value-initialized if there are none. The vector is
+    // unchanged if a constructor throws.
+    template <typename... Args>
+    reference EmplaceBack(Args&&... args);
+
+    void PushBack(const value_type& row);
+    void PushBack(value_type&& row);
+
+    void PopBack() noexcept;
+
+    iterator Erase(const_iterator pos);
+
+    // Removes rows [first, last), shifting each column's tail once
+    iterator Erase(const_iterator first, const_iterator last);
+
+    void Clear() noexcept;
+
+    const_reference operator[](size_t index) const noexcept;
+    reference operator[](size_t index) noexcept;
+
+    // The I-th field of every row
+    template <size_t I>
+    ColumnSpan<Field<I>> Column() noexcept;
+    template <size_t I>
+    ColumnSpan<const Field<I>> Column() const noexcept;
+
+    size_t Size() const noexcept { return size_; }
+    size_t Capacity() const noexcept { return std::get<0>(columns_).Capacity(); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size_); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    ~SoAVector();
+
+private:
+    using Columns = std::tuple<RawMemory<Ts>...>;
+    using Growth = DefaultGrowth;
+
+    // Fields that are copied rather than moved on reallocation, because
+    // their move constructor may throw
+    template <typename T>
+    static constexpr bool kCopiedOnGrowth = !kIsTriviallyRelocatable<T>
+        && !std::is_nothrow_move_constructible_v<T> && std::is_copy_constructible_v<T>;
+
+    Columns columns_;
+    size_t size_ = 0;
+
+    template <size_t I>
+    Field<I>* ColumnData() const noexcept {
+        return const_cast<Field<I>*>(std::get<I>(columns_).GetAddress());
+    }
+
+    // Calls `fn(std::integral_constant<size_t, I>)` for every column I
+    template <typename Fn>
+    static void ForEachColumn(Fn&& fn);
+    template <typename Fn, size_t... Is>
+    static void ForEachColumn(Fn& fn, std::index_sequence<Is...>);
+
+    size_t GrownCapacity(size_t required) const noexcept;
+
+    // Moves all rows into columns of exactly `new_capacity` >= size_ rows
+    void Reallocate(size_t new_capacity);
+
+    // Builds row `index` of `columns` from a tuple of arguments, destroying
+    // the fields already built if one of them throws
+    template <typename Row, size_t... Is>
+    static void ConstructRow(Columns& columns, size_t index, Row&& row, std::index_sequence<Is...>);
+
+    template <typename Row>
+    reference EmplaceRow(Row&& row);
+
+    // Moves `count` rows from `from` into the uninitialized `to`. If a
+    // copy throws, `from` is untouched and nothing is left in `to`.
+    static void TransferRows(Columns& from, Columns& to, size_t count);
+
+    void DestroyRows(size_t first, size_t last) noexcept;
+};
+
+// Proxy for one row. Copying the proxy refers to the same row; assigning a
+// row value or another proxy assigns the fields.
+template <typename... Ts>
+template <bool IsConst>
+class SoAVector<Ts...>::RowRef {
+public:
+    using Owner = std::conditional_t<IsConst, const SoAVector, SoAVector>;
+
+    RowRef(Owner* owner, size_t index) noexcept : owner_(owner), index_(index) {}
+    RowRef(const RowRef&) = default;
+
+    // reference converts to const_reference
+    template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+    RowRef(const RowRef<OtherConst>& other) noexcept : owner_(other.owner_), index_(other.index_) {}
+
+    template <size_t I>
+    std::conditional_t<IsConst, const Field<I>&, Field<I>&> Get() const noexcept {
+        return owner_->template ColumnData<I>()[index_];
+    }
+
+    operator value_type() const {
+        return ToTuple(std::index_sequence_for<Ts...>{});
+    }
+
+    const RowRef& operator=(const value_type& row) const {
+        static_assert(!IsConst, "Cannot assign through a const row");
+        Assign(row, std::index_sequence_for<Ts...>{});
+        return *this;
+    }
+
+    const RowRef& operator=(const RowRef& other) const {
+        return *this = static_cast<value_type>(other);
+    }
+
+private:
+    template <bool>
+    friend class RowRef;
+
+    template <size_t... Is>
+    value_type ToTuple(std::index_sequence<Is...>) const {
+        return value_type(Get<Is>()...);
+    }
+
+    template <size_t... Is>
+    void Assign(const value_type& row, std::index_sequence<Is...>) const {
+        ((Get<Is>() = std::get<Is>(row)), ...);
+    }
+
+    Owner* owner_;
+    size_t index_;
+};
+
+// Random-access iterator over row proxies. Like std::vector<bool>'s, it
+// yields proxies by value, so operator-> is not provided.
+template <typename... Ts>
+template <bool IsConst>
+class SoAVector<Ts...>::Iterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = typename SoAVector::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = RowRef<IsConst>;
+    using Owner = std::conditional_t<IsConst, const SoAVector, SoAVector>;
+
+    Iterator() = default;
+    Iterator(Owner* owner, size_t index) noexcept : owner_(owner), index_(index) {}
+
+    // iterator converts to const_iterator
+    template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+    Iterator(const Iterator<OtherConst>& other) noexcept : owner_(other.owner_), index_(other.index_) {}
+
+    reference operator*() const noexcept { return reference(owner_, index_); }
+    reference operator[](difference_type n) const noexcept { return reference(owner_, index_ + n); }
+
+    Iterator& operator++() noexcept { ++index_; return *this; }
+    Iterator& operator--() noexcept { --index_; return *this; }
+    Iterator operator++(int) noexcept { Iterator old = *this; ++index_; return old; }
+    Iterator operator--(int) noexcept { Iterator old = *this; --index_; return old; }
+    Iterator& operator+=(difference_type n) noexcept { index_ += n; return *this; }
+    Iterator& operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+
+    friend Iterator operator+(Iterator it, difference_type n) noexcept { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) noexcept { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const Iterator& a, const Iterator& b) noexcept {
+        return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+    }
+
+    bool operator==(const Iterator& other) const noexcept { return index_ == other.index_; }
+    bool operator!=(const Iterator& other) const noexcept { return index_ != other.index_; }
+    bool operator<(const Iterator& other) const noexcept { return index_ < other.index_; }
+    bool operator>(const Iterator& other) const noexcept { return index_ > other.index_; }
+    bool operator<=(const Iterator& other) const noexcept { return index_ <= other.index_; }
+    bool operator>=(const Iterator& other) const noexcept { return index_ >= other.index_; }
+
+private:
+    friend class SoAVector;
+    template <bool>
+    friend class Iterator;
+
+    Owner* owner_ = nullptr;
+    size_t index_ = 0;
+};
+
+
+// Implementation of SoAVector class template methods
+
+
+template <typename... Ts>
+SoAVector<Ts...>::SoAVector(size_t size) {
+    Resize(size);
+}
+
+template <typename... Ts>
+SoAVector<Ts...>::SoAVector(const SoAVector& other)
+    : columns_(RawMemory<Ts>(other.size_)...) {
+    size_t copied = 0;
+    try {
+        ForEachColumn([&](auto column) {
+            std::uninitialized_copy_n(other.ColumnData<column>(), other.size_, ColumnData<column>());
+            ++copied;
+        });
+    } catch (...) {
+        ForEachColumn([&](auto column) {
+            if (column < copied) {
+                std::destroy_n(ColumnData<column>(), other.size_);
+            }
+        });
+        throw;
+    }
+    size_ = other.size_;
+}
+
+template <typename... Ts>
+SoAVector<Ts...>::SoAVector(SoAVector&& other) noexcept
+    : columns_(std::move(other.columns_))
+    , size_(std::exchange(other.size_, 0)) {
+}
+
+template <typename... Ts>
+SoAVector<Ts...>& SoAVector<Ts...>::operator=(const SoAVector& rhs) {
+    if (this != &rhs) {
+        SoAVector copy(rhs);
+        Swap(copy);
+    }
+    return *this;
+}
+
+template <typename... Ts>
+SoAVector<Ts...>& SoAVector<Ts...>::operator=(SoAVector&& rhs) noexcept {
+    if (this != &rhs) {
+        SoAVector moved(std::move(rhs));
+        Swap(moved);
+    }
+    return *this;
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::Swap(SoAVector& other) noexcept {
+    ForEachColumn([&](auto column) {
+        std::get<column>(columns_).Swap(std::get<column>(other.columns_));
+    });
+    std::swap(size_, other.size_);
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::Resize(size_t new_size) {
+    if (new_size < size_) {
+        DestroyRows(new_size, size_);
+        size_ = new_size;
+        return;
+    }
+    if (new_size > Capacity()) {
+        Reallocate(GrownCapacity(new_size));
+    }
+    while (size_ < new_size) {
+        EmplaceBack();
+    }
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::Reserve(size_t new_capacity) {
+    if (new_capacity <= Capacity()) {
+        return;
+    }
+    Reallocate(std::max(new_capacity, Growth::template Fit<value_type>(new_capacity)));
+}
+
+template <typename... Ts>
+template <typename... Args>
+typename SoAVector<Ts...>::reference SoAVector<Ts...>::EmplaceBack(Args&&... args) {
+    static_assert(sizeof...(Args) == 0 || sizeof...(Args) == sizeof...(Ts),
+                  "EmplaceBack takes one argument per field");
+    return EmplaceRow(std::forward_as_tuple(std::forward<Args>(args)...));
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::PushBack(const value_type& row) {
+    EmplaceRow(row);
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::PushBack(value_type&& row) {
+    EmplaceRow(std::move(row));
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::PopBack() noexcept {
+    assert(size_ > 0);
+    DestroyRows(size_ - 1, size_);
+    --size_;
+}
+
+template <typename... Ts>
+typename SoAVector<Ts...>::iterator SoAVector<Ts...>::Erase(const_iterator pos) {
+    return Erase(pos, pos + 1);
+}
+
+template <typename... Ts>
+typename SoAVector<Ts...>::iterator SoAVector<Ts...>::Erase(const_iterator first, const_iterator last) {
+    const size_t index = first.index_;
+    const size_t count = last.index_ - first.index_;
+    assert(index + count <= size_);
+    if (count == 0) {
+        return iterator(this, index);
+    }
+    ForEachColumn([&](auto column) {
+        auto* erased = ColumnData<column>() + index;
+        using T = std::remove_pointer_t<decltype(erased)>;
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            std::destroy_n(erased, count);
+            TrivialRelocateOverlapping(erased + count, size_ - index - count, erased);
+        } else {
+            std::move(erased + count, ColumnData<column>() + size_, erased);
+            std::destroy_n(ColumnData<column>() + size_ - count, count);
+        }
+    });
+    size_ -= count;
+    return iterator(this, index);
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::Clear() noexcept {
+    DestroyRows(0, size_);
+    size_ = 0;
+}
+
+template <typename... Ts>
+typename SoAVector<Ts...>::const_reference SoAVector<Ts...>::operator[](size_t index) const noexcept {
+    assert(index < size_);
+    return const_reference(this, index);
+}
+
+template <typename... Ts>
+typename SoAVector<Ts...>::reference SoAVector<Ts...>::operator[](size_t index) noexcept {
+    assert(index < size_);
+    return reference(this, index);
+}
+
+template <typename... Ts>
+template <size_t I>
+ColumnSpan<typename SoAVector<Ts...>::template Field<I>> SoAVector<Ts...>::Column() noexcept {
+    return ColumnSpan<Field<I>>(ColumnData<I>(), size_);
+}
+
+template <typename... Ts>
+template <size_t I>
+ColumnSpan<const typename SoAVector<Ts...>::template Field<I>> SoAVector<Ts...>::Column() const noexcept {
+    return ColumnSpan<const Field<I>>(ColumnData<I>(), size_);
+}
+
+template <typename... Ts>
+SoAVector<Ts...>::~SoAVector() {
+    DestroyRows(0, size_);
+}
+
+template <typename... Ts>
+template <typename Fn>
+void SoAVector<Ts...>::ForEachColumn(Fn&& fn) {
+    ForEachColumn(fn, std::index_sequence_for<Ts...>{});
+}
+
+template <typename... Ts>
+template <typename Fn, size_t... Is>
+void SoAVector<Ts...>::ForEachColumn(Fn& fn, std::index_sequence<Is...>) {
+    (fn(std::integral_constant<size_t, Is>{}), ...);
+}
+
+template <typename... Ts>
+size_t SoAVector<Ts...>::GrownCapacity(size_t required) const noexcept {
+    return std::max(required, Growth::template Grow<value_type>(Capacity(), required));
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::Reallocate(size_t new_capacity) {
+    assert(new_capacity >= size_);
+    Columns fresh{RawMemory<Ts>(new_capacity)...};
+    TransferRows(columns_, fresh, size_);
+    columns_.swap(fresh);
+}
+
+template <typename... Ts>
+template <typename Row, size_t... Is>
+void SoAVector<Ts...>::ConstructRow(Columns& columns, size_t index, Row&& row, std::index_sequence<Is...>) {
+    size_t constructed = 0;
+    try {
+        if constexpr (std::tuple_size_v<std::remove_reference_t<Row>> == 0) {
+            ((new (std::get<Is>(columns) + index) Ts(), ++constructed), ...);
+        } else {
+            ((new (std::get<Is>(columns) + index) Ts(std::get<Is>(std::forward<Row>(row))), ++constructed), ...);
+        }
+    } catch (...) {
+        ForEachColumn([&](auto column) {
+            if (column < constructed) {
+                std::destroy_at(std::get<column>(columns) + index);
+            }
+        });
+        throw;
+    }
+}
+
+template <typename... Ts>
+template <typename Row>
+typename SoAVector<Ts...>::reference SoAVector<Ts...>::EmplaceRow(Row&& row) {
+    if (size_ < Capacity()) {
+        ConstructRow(columns_, size_, std::forward<Row>(row), std::index_sequence_for<Ts...>{});
+    } else {
+        // The new row is built before the old ones move, since `row` may
+        // refer to them
+        Columns fresh{RawMemory<Ts>(GrownCapacity(size_ + 1))...};
+        ConstructRow(fresh, size_, std::forward<Row>(row), std::index_sequence_for<Ts...>{});
+        try {
+            TransferRows(columns_, fresh, size_);
+        } catch (...) {
+            ForEachColumn([&](auto column) {
+                std::destroy_at(std::get<column>(fresh) + size_);
+            });
+            throw;
+        }
+        columns_.swap(fresh);
+    }
+    return reference(this, size_++);
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::TransferRows(Columns& from, Columns& to, size_t count) {
+    // Columns whose move may throw are copied first, so that a failure
+    // happens before any other column has given up its elements
+    size_t copied = 0;
+    try {
+        ForEachColumn([&](auto column) {
+            using T = std::tuple_element_t<column, value_type>;
+            if constexpr (kCopiedOnGrowth<T>) {
+                std::uninitialized_copy_n(std::get<column>(from) + 0, count, std::get<column>(to) + 0);
+                copied = column + 1;
+            }
+        });
+    } catch (...) {
+        ForEachColumn([&](auto column) {
+            using T = std::tuple_element_t<column, value_type>;
+            if constexpr (kCopiedOnGrowth<T>) {
+                if (column < copied) {
+                    std::destroy_n(std::get<column>(to) + 0, count);
+                }
+            }
+        });
+        throw;
+    }
+    ForEachColumn([&](auto column) {
+        using T = std::tuple_element_t<column, value_type>;
+        T* source = std::get<column>(from) + 0;
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            TrivialRelocate(source, count, std::get<column>(to) + 0);
+            return;
+        } else if constexpr (!kCopiedOnGrowth<T>) {
+            std::uninitialized_move_n(source, count, std::get<column>(to) + 0);
+        }
+        std::destroy_n(source, count);
+    });
+}
+
+template <typename... Ts>
+void SoAVector<Ts...>::DestroyRows(size_t first, size_t last) noexcept {
+    ForEachColumn([&](auto column) {
+        std::destroy(ColumnData<column>() + first, ColumnData<column>() + last);
+    });
+}
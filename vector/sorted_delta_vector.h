@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "vector.h"
+
+// SortedDeltaVector stores a non-decreasing sequence of uint64_t compactly.
+// Values are grouped in blocks of 128. Each block has a skip entry holding
+// its first value and the offset of its bytes. The other 127 values are
+// stored as varint-encoded gaps to their predecessor. Dense ID lists take
+// one or two bytes per value, plus 16 bytes per block for the skip entry.
+//
+// Iteration decodes sequentially. LowerBound binary searches the skip
+// entries and then decodes at most one block; operator[] also decodes
+// within one block. PushBack appends in O(1) and invalidates iterators.
+class SortedDeltaVector {
+public:
+    class ConstIterator;
+
+    using const_iterator = ConstIterator;
+
+    static constexpr size_t kBlockSize = 128;
+
+    SortedDeltaVector() = default;
+
+    // Encodes a sorted range
+    SortedDeltaVector(const uint64_t* values, size_t size);
+    template <typename A, typename G>
+    explicit SortedDeltaVector(const Vector<uint64_t, A, G>& values)
+        : SortedDeltaVector(values.begin(), values.Size()) {}
+
+    // Appends a value not less than the last one
+    void PushBack(uint64_t value);
+
+    // Decodes the value at `index`, reading at most one block
+    uint64_t operator[](size_t index) const noexcept;
+
+    // First element not less than `value`, or end()
+    ConstIterator LowerBound(uint64_t value) const noexcept;
+    bool Contains(uint64_t value) const noexcept;
+
+    // Replaces the contents of `out` with all elements
+    template <typename A, typename G>
+    void Decode(Vector<uint64_t, A, G>& out) const;
+
+    size_t Size() const noexcept { return size_; }
+    uint64_t Back() const noexcept {
+        assert(size_ > 0);
+        return last_;
+    }
+
+    ConstIterator begin() const noexcept;
+    ConstIterator end() const noexcept;
+
+    // Memory taken by the skip entries and the encoded gaps
+    size_t MemoryBytes() const noexcept;
+
+private:
+    struct Block {
+        uint64_t first;
+        size_t offset;
+    };
+
+    Vector<Block> blocks_;
+    Vector<uint8_t> bytes_;
+    size_t size_ = 0;
+    uint64_t last_ = 0;
+
+    // Iterator to the first element of block `block`
+    ConstIterator BlockBegin(size_t block) const noexcept;
+
+    static void PutVarint(Vector<uint8_t>& out, uint64_t value);
+    static uint64_t GetVarint(const uint8_t*& in) noexcept;
+};
+
+// Input iterator decoding one gap per increment. The current value lives in
+// the iterator, so it is returned by value rather than by reference.
+class SortedDeltaVector::ConstIterator {
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = uint64_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = uint64_t;
+
+    ConstIterator() = default;
+    ConstIterator(const SortedDeltaVector* owner, size_t index, uint64_t value, const uint8_t* next) noexcept
+        : owner_(owner), index_(index), value_(value), next_(next) {}
+
+    uint64_t operator*() const noexcept { return value_; }
+
+    ConstIterator& operator++() noexcept;
+    ConstIterator operator++(int) noexcept {
+        ConstIterator old = *this;
+        ++*this;
+        return old;
+    }
+
+    // Position in the sequence
+    size_t Index() const noexcept { return index_; }
+
+    bool operator==(const ConstIterator& other) const noexcept { return index_ == other.index_; }
+    bool operator!=(const ConstIterator& other) const noexcept { return index_ != other.index_; }
+
+private:
+    const SortedDeltaVector* owner_ = nullptr;
+    size_t index_ = 0;
+    uint64_t value_ = 0;
+    // Gap of the next element, if it is in the same block
+    const uint8_t* next_ = nullptr;
+};
+
+
+// Implementation of SortedDeltaVector class methods
+
+
+inline SortedDeltaVector::SortedDeltaVector(const uint64_t* values, size_t size) {
+    blocks_.Reserve((size + kBlockSize - 1) / kBlockSize);
+    // A byte per gap is typical for dense ID lists
+    bytes_.Reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        PushBack(values[i]);
+    }
+}
+
+inline void SortedDeltaVector::PushBack(uint64_t value) {
+    assert(size_ == 0 || value >= last_);
+    if (size_ % kBlockSize == 0) {
+        blocks_.PushBack(Block{value, bytes_.Size()});
+    } else {
+        PutVarint(bytes_, value - last_);
+    }
+    last_ = value;
+    ++size_;
+}
+
+inline uint64_t SortedDeltaVector::operator[](size_t index) const noexcept {
+    assert(index < size_);
+    ConstIterator it = BlockBegin(index / kBlockSize);
+    for (size_t i = index % kBlockSize; i > 0; --i) {
+        ++it;
+    }
+    return *it;
+}
+
+inline SortedDeltaVector::ConstIterator SortedDeltaVector::LowerBound(uint64_t value) const noexcept {
+    // Block `next` is the first one starting at or above `value`, so the
+    // answer is either in the block before it or is its first element
+    const Block* found = std::lower_bound(blocks_.begin(), blocks_.end(), value,
+                                          [](const Block& block, uint64_t v) { return block.first < v; });
+    const size_t next = found - blocks_.begin();
+    if (next == 0) {
+        return begin();
+    }
+    ConstIterator it = BlockBegin(next - 1);
+    const size_t block_end = std::min(next * kBlockSize, size_);
+    while (it.Index() < block_end && *it < value) {
+        ++it;
+    }
+    return it;
+}
+
+inline bool SortedDeltaVector::Contains(uint64_t value) const noexcept {
+    const ConstIterator it = LowerBound(value);
+    return it != end() && *it == value;
+}
+
+template <typename A, typename G>
+void SortedDeltaVector::Decode(Vector<uint64_t, A, G>& out) const {
+    out.Resize(0);
+    uint64_t* data = out.AppendUninitialized(size_);
+    for (uint64_t value : *this) {
+        *data++ = value;
+    }
+}
+
+inline SortedDeltaVector::ConstIterator SortedDeltaVector::begin() const noexcept {
+    return size_ == 0 ? end() : BlockBegin(0);
+}
+
+inline SortedDeltaVector::ConstIterator SortedDeltaVector::end() const noexcept {
+    return ConstIterator(this, size_, 0, nullptr);
+}
+
+inline size_t SortedDeltaVector::MemoryBytes() const noexcept {
+    return blocks_.Capacity() * sizeof(Block) + bytes_.Capacity();
+}
+
+inline SortedDeltaVector::ConstIterator SortedDeltaVector::BlockBegin(size_t block) const noexcept {
+    if (block == blocks_.Size()) {
+        return end();
+    }
+    return ConstIterator(this, block * kBlockSize, blocks_[block].first, bytes_.begin() + blocks_[block].offset);
+}
+
+inline void SortedDeltaVector::PutVarint(Vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.PushBack(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.PushBack(static_cast<uint8_t>(value));
+}
+
+inline uint64_t SortedDeltaVector::GetVarint(const uint8_t*& in) noexcept {
+    uint64_t value = 0;
+    for (size_t shift = 0;; shift += 7) {
+        const uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+
+// Implementation of SortedDeltaVector::ConstIterator class methods
+
+
+inline SortedDeltaVector::ConstIterator& SortedDeltaVector::ConstIterator::operator++() noexcept {
+    ++index_;
+    if (index_ == owner_->size_) {
+        next_ = nullptr;
+    } else if (index_ % kBlockSize == 0) {
+        *this = owner_->BlockBegin(index_ / kBlockSize);
+    } else {
+        value_ += GetVarint(next_);
+    }
+    return *this;
+}
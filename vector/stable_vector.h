@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "raw_memory.h"
+#include "segment_layout.h"
+#include "vector.h"
+
+// StableVector stores its elements in RawMemory segments of doubling size
+// (see SegmentLayout) instead of one contiguous buffer. Growing allocates
+// one more segment and never moves existing elements, so pointers and
+// references stay valid until the element is removed, and PushBack has
+// no O(n) spikes. Indexing costs a bit scan more than Vector's.
+template <typename T, typename Alloc = std::allocator<T>>
+class StableVector {
+    template <bool IsConst>
+    class Iterator;
+
+public:
+    using allocator_type = typename RawMemory<T, Alloc>::allocator_type;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    StableVector() = default;
+    explicit StableVector(const allocator_type& alloc) noexcept;
+    explicit StableVector(size_t size, const allocator_type& alloc = allocator_type());
+    StableVector(const StableVector& other);
+    StableVector(StableVector&& other) noexcept;
+
+    StableVector& operator=(const StableVector& rhs);
+    StableVector& operator=(StableVector&& rhs) noexcept;
+
+    void Swap(StableVector& other) noexcept;
+
+    // Resizes the vector to contain `new_size` elements
+    void Resize(size_t new_size);
+
+    // Allocates the segments needed to hold `new_capacity` elements
+    void Reserve(size_t new_capacity);
+
+    void PopBack() noexcept;
+
+    template <typename V>
+    void PushBack(V&& value);
+
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args);
+
+    const T& operator[](size_t index) const noexcept;
+    T& operator[](size_t index) noexcept;
+
+    size_t Size() const noexcept { return size_; }
+    size_t Capacity() const noexcept { return Layout::SegmentStart(segments_.Size()); }
+
+    iterator begin() noexcept { return iterator(this, 0); }
+    iterator end() noexcept { return iterator(this, size_); }
+    const_iterator begin() const noexcept { return const_iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(this, size_); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    const_iterator cend() const noexcept { return end(); }
+
+    allocator_type GetAllocator() const noexcept { return alloc_; }
+
+    ~StableVector();
+
+private:
+    using Layout = SegmentLayout<T>;
+
+    allocator_type alloc_;
+    Vector<RawMemory<T, Alloc>> segments_;
+    size_t size_ = 0;
+
+    // Storage for element `index`, constructed or not
+    T* Slot(size_t index) noexcept;
+
+    // Destroys all elements, keeping the segments
+    void Clear() noexcept;
+};
+
+template <typename T, typename Alloc>
+template <bool IsConst>
+class StableVector<T, Alloc>::Iterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = T;
+    using difference_type = std::ptrdiff_t;
+    using pointer = std::conditional_t<IsConst, const T*, T*>;
+    using reference = std::conditional_t<IsConst, const T&, T&>;
+    using Owner = std::conditional_t<IsConst, const StableVector, StableVector>;
+
+    Iterator() = default;
+    Iterator(Owner* owner, size_t index) noexcept : owner_(owner), index_(index) {}
+
+    // iterator converts to const_iterator
+    template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+    Iterator(const Iterator<OtherConst>& other) noexcept : owner_(other.owner_), index_(other.index_) {}
+
+    reference operator*() const noexcept { return (*owner_)[index_]; }
+    pointer operator->() const noexcept { return &(*owner_)[index_]; }
+    reference operator[](difference_type n) const noexcept { return (*owner_)[index_ + n]; }
+
+    Iterator& operator++() noexcept { ++index_; return *this; }
+    Iterator& operator--() noexcept { --index_; return *this; }
+    Iterator operator++(int) noexcept { Iterator old = *this; ++index_; return old; }
+    Iterator operator--(int) noexcept { Iterator old = *this; --index_; return old; }
+    Iterator& operator+=(difference_type n) noexcept { index_ += n; return *this; }
+    Iterator& operator-=(difference_type n) noexcept { index_ -= n; return *this; }
+
+    friend Iterator operator+(Iterator it, difference_type n) noexcept { return it += n; }
+    friend Iterator operator+(difference_type n, Iterator it) noexcept { return it += n; }
+    friend Iterator operator-(Iterator it, difference_type n) noexcept { return it -= n; }
+    friend difference_type operator-(const Iterator& a, const Iterator& b) noexcept {
+        return static_cast<difference_type>(a.index_) - static_cast<difference_type>(b.index_);
+    }
+
+    bool operator==(const Iterator& other) const noexcept { return index_ == other.index_; }
+    bool operator!=(const Iterator& other) const noexcept { return index_ != other.index_; }
+    bool operator<(const Iterator& other) const noexcept { return index_ < other.index_; }
+    bool operator>(const Iterator& other) const noexcept { return index_ > other.index_; }
+    bool operator<=(const Iterator& other) const noexcept { return index_ <= other.index_; }
+    bool operator>=(const Iterator& other) const noexcept { return index_ >= other.index_; }
+
+private:
+    template <bool>
+    friend class Iterator;
+
+    Owner* owner_ = nullptr;
+    size_t index_ = 0;
+};
+
+
+// Implementation of StableVector class template methods
+
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>::StableVector(const allocator_type& alloc) noexcept
+    : alloc_(alloc) {}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>::StableVector(size_t size, const allocator_type& alloc)
+    : alloc_(alloc) {
+    Resize(size);
+}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>::StableVector(const StableVector& other)
+    : alloc_(std::allocator_traits<allocator_type>::select_on_container_copy_construction(other.alloc_)) {
+    Reserve(other.size_);
+    try {
+        for (const T& value : other) {
+            EmplaceBack(value);
+        }
+    } catch (...) {
+        Clear();
+        throw;
+    }
+}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>::StableVector(StableVector&& other) noexcept
+    : alloc_(other.alloc_)
+    , segments_(std::move(other.segments_))
+    , size_(std::exchange(other.size_, 0)) {
+}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>& StableVector<T, Alloc>::operator=(const StableVector& rhs) {
+    if (this != &rhs) {
+        StableVector copy(rhs);
+        Swap(copy);
+    }
+    return *this;
+}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>& StableVector<T, Alloc>::operator=(StableVector&& rhs) noexcept {
+    if (this != &rhs) {
+        StableVector moved(std::move(rhs));
+        Swap(moved);
+    }
+    return *this;
+}
+
+template <typename T, typename Alloc>
+void StableVector<T, Alloc>::Swap(StableVector& other) noexcept {
+    // Every segment carries its own allocator, so the allocators are swapped
+    // together with the segments
+    std::swap(alloc_, other.alloc_);
+    segments_.Swap(other.segments_);
+    std::swap(size_, other.size_);
+}
+
+template <typename T, typename Alloc>
+void StableVector<T, Alloc>::Resize(size_t new_size) {
+    Reserve(new_size);
+    while (size_ > new_size) {
+        PopBack();
+    }
+    while (size_ < new_size) {
+        EmplaceBack();
+    }
+}
+
+template <typename T, typename Alloc>
+void StableVector<T, Alloc>::Reserve(size_t new_capacity) {
+    while (Capacity() < new_capacity) {
+        segments_.EmplaceBack(Layout::SegmentSize(segments_.Size()), alloc_);
+    }
+}
+
+template <typename T, typename Alloc>
+void StableVector<T, Alloc>::PopBack() noexcept {
+    assert(size_ > 0);
+    std::destroy_at(&(*this)[size_ - 1]);
+    --size_;
+}
+
+template <typename T, typename Alloc>
+template <typename V>
+void StableVector<T, Alloc>::PushBack(V&& value) {
+    EmplaceBack(std::forward<V>(value));
+}
+
+template <typename T, typename Alloc>
+template <typename... Args>
+T& StableVector<T, Alloc>::EmplaceBack(Args&&... args) {
+    if (size_ == Capacity()) {
+        // Arguments may refer to existing elements: they do not move
+        segments_.EmplaceBack(Layout::SegmentSize(segments_.Size()), alloc_);
+    }
+    T* slot = Slot(size_);
+    new (slot) T(std::forward<Args>(args)...);
+    ++size_;
+    return *slot;
+}
+
+template <typename T, typename Alloc>
+const T& StableVector<T, Alloc>::operator[](size_t index) const noexcept {
+    return const_cast<StableVector&>(*this)[index];
+}
+
+template <typename T, typename Alloc>
+T& StableVector<T, Alloc>::operator[](size_t index) noexcept {
+    assert(index < size_);
+    return *Slot(index);
+}
+
+template <typename T, typename Alloc>
+T* StableVector<T, Alloc>::Slot(size_t index) noexcept {
+    assert(index < Capacity());
+    const size_t segment = Layout::SegmentOf(index);
+    return segments_[segment] + (index - Layout::SegmentStart(segment));
+}
+
+template <typename T, typename Alloc>
+void StableVector<T, Alloc>::Clear() noexcept {
+    while (size_ > 0) {
+        PopBack();
+    }
+}
+
+template <typename T, typename Alloc>
+StableVector<T, Alloc>::~StableVector() {
+    Clear();
+}
@@ -2,34 +2,83 @@
 
 #include <algorithm>
 #include <cassert>
-
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "growth_policy.h"
 #include "raw_memory.h"
+#include "relocation.h"
+
+template <typename It, typename = void>
+struct IsIterator : std::false_type {};
 
-template <typename T>
+template <typename It>
+struct IsIterator<It, std::void_t<typename std::iterator_traits<It>::iterator_category>> : std::true_type {};
+
+// `Growth` is a compile-time policy choosing the capacity on reallocation,
+// see growth_policy.h.
+template <typename T, typename Alloc = std::allocator<T>, typename Growth = DefaultGrowth>
 class Vector {
 public:
     using iterator = T*;
     using const_iterator = const T*;
+    using allocator_type = typename RawMemory<T, Alloc>::allocator_type;
 
     Vector() = default;
-    explicit Vector(size_t size);
+    explicit Vector(const allocator_type& alloc) noexcept;
+    explicit Vector(size_t size, const allocator_type& alloc = allocator_type());
     Vector(const Vector& other);
     Vector(Vector&& other) noexcept;
 
     Vector& operator=(const Vector& rhs);
-    Vector& operator=(Vector&& rhs) noexcept;
+    Vector& operator=(Vector&& rhs) noexcept(
+        std::allocator_traits<allocator_type>::propagate_on_container_move_assignment::value
+        || std::allocator_traits<allocator_type>::is_always_equal::value);
 
-    // Swaps contents with another vector
+    // Swaps contents with another vector. Allocators are swapped only if
+    // they propagate on swap, otherwise they must compare equal.
     void Swap(Vector& other) noexcept;
 
     // Resizes the vector to contain `new_size` elements
     void Resize(size_t new_size);
 
+    // Like Resize, but new elements are default-initialized: trivial types
+    // are left uninitialized. Returns a pointer to the first new element,
+    // ready to be filled e.g. by a socket read or a decoder.
+    T* ResizeDefaultInit(size_t new_size);
+
+    // Appends `count` default-initialized elements and returns a pointer
+    // to the first of them
+    T* AppendUninitialized(size_t count);
+
     // Ensures that the vector has at least `new_capacity`
-    // storage capacity.
+    // storage capacity. The growth policy may round the capacity up.
     void Reserve(size_t new_capacity);
 
+    // Reduces the capacity to the size, releasing the whole buffer if the
+    // vector is empty. Invalidates iterators if the buffer changes.
+    void ShrinkToFit();
+
     iterator Erase(const_iterator pos);
+
+    // Removes [first, last), shifting the tail once
+    iterator Erase(const_iterator first, const_iterator last);
+
+    // Removes the element at `pos` in O(1) by moving the last element into
+    // its place. Does not preserve the order of elements.
+    iterator SwapErase(const_iterator pos);
+
+    // Removes all elements satisfying `pred` in a single compaction pass
+    // and returns how many were removed
+    template <typename Pred>
+    friend size_t EraseIf(Vector& vec, Pred pred) {
+        return vec.CompactIf(pred);
+    }
+
     void PopBack();
     
     template <typename V>
@@ -44,6 +93,18 @@ public:
     template <typename V>
     iterator Insert(const_iterator pos, V&& value);
 
+    // Inserts copies of [first, last) before `pos`. The tail is shifted once
+    // and the vector reallocates at most once.
+    template <typename InputIt, typename = std::enable_if_t<IsIterator<InputIt>::value>>
+    iterator Insert(const_iterator pos, InputIt first, InputIt last);
+
+    // Inserts `count` copies of `value` before `pos`
+    iterator Insert(const_iterator pos, size_t count, const T& value);
+
+    // Appends all elements of `range`, moving them out if it is an rvalue
+    template <typename Range>
+    void Append(Range&& range);
+
     const T& operator[](size_t index) const noexcept;
     T& operator[](size_t index) noexcept;
 
@@ -56,15 +117,45 @@ public:
     const_iterator end() const noexcept;
     const_iterator cbegin() const noexcept;
     const_iterator cend() const noexcept;
+
+    allocator_type GetAllocator() const noexcept { return data_.GetAllocator(); }
     
     ~Vector();
 
 private:
-    RawMemory<T> data_;
+    using AllocTraits = std::allocator_traits<allocator_type>;
+
+    RawMemory<T, Alloc> data_;
     size_t size_ = 0;
     
+    // Largest capacity the allocator can provide
+    size_t MaxCapacity() const noexcept;
+
+    // Capacity chosen by the growth policy to fit `required` elements,
+    // limited by the allocator's max_size
+    size_t GrownCapacity(size_t required) const noexcept;
+
+    // Moves the elements to a buffer of exactly `new_capacity` >= size_
+    // elements, resizing in place if the allocator allows
+    void Reallocate(size_t new_capacity);
+
+    // Applies the growth policy's Shrink hook, if any, after a removal.
+    // Shrinking is best effort: a failed allocation keeps the buffer.
+    void ShrinkIfSparse() noexcept;
+
+    template <typename Pred>
+    size_t CompactIf(Pred& pred);
+
+    // True if `ptr` points into the constructed elements
+    bool Contains(const T* ptr) const noexcept;
+
+    // Inserts `count` elements before `pos`, built by `construct(T* dest)`
+    // in uninitialized memory. `construct` must build all of them or none.
+    template <typename Construct>
+    iterator InsertWith(const_iterator pos, size_t count, Construct&& construct);
+
     // Internal helper for uninitialized memory copy or move
-    void UninitializedMoveOrCopy(iterator from, int number_of_elements, iterator to);
+    void UninitializedMoveOrCopy(iterator from, size_t number_of_elements, iterator to);
     
     // Helper for `Emplace` method with reallocation
     template <typename... Args>
@@ -90,34 +181,52 @@ private:
 // Implementation details follow:
 
 
-template <typename T>
-Vector<T>::Vector(Vector<T>&& other) noexcept {
-    data_ = std::move(other.data_);
-    size_ = std::exchange(other.size_, 0);
-}
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(Vector<T, Alloc, Growth>&& other) noexcept
+    : data_(std::move(other.data_))
+    , size_(std::exchange(other.size_, 0)) {}
 
-template <typename T>
-Vector<T>::Vector(size_t size)
-    : data_(size)        
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(const allocator_type& alloc) noexcept
+    : data_(alloc) {}
+
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(size_t size, const allocator_type& alloc)
+    : data_(size, alloc)        
     , size_(size)  
 {
     std::uninitialized_value_construct_n(data_.GetAddress(), size);
 }
 
-template <typename T>
-Vector<T>::Vector(const Vector& other)
-    : data_(other.size_)        
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::Vector(const Vector& other)
+    : data_(other.size_, AllocTraits::select_on_container_copy_construction(other.data_.GetAllocator()))
     , size_(other.size_)             
 {  
     std::uninitialized_copy_n(other.data_.GetAddress(), other.size_, data_.GetAddress());        
 } 
 
-template <typename T>
-Vector<T>& Vector<T>::operator=(const Vector<T>& rhs) {
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>& Vector<T, Alloc, Growth>::operator=(const Vector<T, Alloc, Growth>& rhs) {
     if (this != &rhs) {
-        if (rhs.size_ > data_.Capacity()) {                      
-            Vector rhs_copy(rhs);
-            Swap(rhs_copy);                
+        if constexpr (AllocTraits::propagate_on_container_copy_assignment::value) {
+            if (data_.GetAllocator() != rhs.data_.GetAllocator()) {
+                // Our buffer cannot be released through rhs's allocator,
+                // so the copy is built with rhs's allocator from scratch.
+                RawMemory<T, Alloc> new_data(rhs.size_, rhs.data_.GetAllocator());
+                std::uninitialized_copy_n(rhs.data_.GetAddress(), rhs.size_, new_data.GetAddress());
+                std::destroy_n(data_.GetAddress(), size_);
+                data_.SwapWithAllocator(new_data);
+                size_ = rhs.size_;
+                return *this;
+            }
+        }
+        if (rhs.size_ > data_.Capacity() && !data_.ExtendInPlace(rhs.size_)) {
+            RawMemory<T, Alloc> new_data(rhs.size_, data_.GetAllocator());
+            std::uninitialized_copy_n(rhs.data_.GetAddress(), rhs.size_, new_data.GetAddress());
+            std::destroy_n(data_.GetAddress(), size_);
+            data_.Swap(new_data);
+            size_ = rhs.size_;
         } else {           
             std::copy_n(rhs.data_.GetAddress(), std::min(size_, rhs.size_), data_.GetAddress());
             if (rhs.size_ < size_) {                    
@@ -131,46 +240,99 @@ Vector<T>& Vector<T>::operator=(const Vector<T>& rhs) {
     return *this;
 }
 
-template <typename T>
-Vector<T>& Vector<T>::operator=(Vector<T>&& rhs) noexcept {
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>& Vector<T, Alloc, Growth>::operator=(Vector<T, Alloc, Growth>&& rhs) noexcept(
+    AllocTraits::propagate_on_container_move_assignment::value || AllocTraits::is_always_equal::value) {
+    if (this == &rhs) {
+        return *this;
+    }
+    if constexpr (!AllocTraits::propagate_on_container_move_assignment::value
+                  && !AllocTraits::is_always_equal::value) {
+        if (data_.GetAllocator() != rhs.data_.GetAllocator()) {
+            // rhs's buffer cannot be adopted, so its elements are moved
+            // one by one into memory owned by our allocator.
+            RawMemory<T, Alloc> new_data(rhs.size_, data_.GetAllocator());
+            UninitializedMoveOrCopy(rhs.begin(), rhs.size_, new_data.GetAddress());
+            std::destroy_n(data_.GetAddress(), size_);
+            data_.Swap(new_data);
+            size_ = rhs.size_;
+            return *this;
+        }
+    }
+    std::destroy_n(data_.GetAddress(), size_);
+    // Propagates the allocator if it propagates on move assignment
     data_ = std::move(rhs.data_);
     size_ = std::exchange(rhs.size_, 0);
     return *this;
 }
 
-template <typename T>
-void Vector<T>::Swap(Vector<T>& other) noexcept {
-    std::swap(data_, other.data_);
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Swap(Vector<T, Alloc, Growth>& other) noexcept {
+    if constexpr (AllocTraits::propagate_on_container_swap::value) {
+        data_.SwapWithAllocator(other.data_);
+    } else {
+        data_.Swap(other.data_);
+    }
     std::swap(size_, other.size_);
 }
 
-template <typename T>
-void Vector<T>::Resize(size_t new_size) {
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Resize(size_t new_size) {
     if (size_ == new_size) return;
     if (new_size < size_) {
         std::destroy_n(data_.GetAddress()+new_size, size_- new_size);                        
-    } else {
-        Reserve(new_size);
-        std::uninitialized_value_construct_n(data_.GetAddress()+size_, new_size - size_);
+        size_ = new_size;
+        ShrinkIfSparse();
+        return;
+    }
+    if (new_size > Capacity()) {
+        Reserve(GrownCapacity(new_size));
+    }
+    std::uninitialized_value_construct_n(data_.GetAddress()+size_, new_size - size_);
+    size_ = new_size;
+}
+
+template <typename T, typename Alloc, typename Growth>
+T* Vector<T, Alloc, Growth>::ResizeDefaultInit(size_t new_size) {
+    const size_t old_size = size_;
+    if (new_size < size_) {
+        std::destroy_n(data_.GetAddress() + new_size, size_ - new_size);
+        size_ = new_size;
+        ShrinkIfSparse();
+        return end();
+    } else if (new_size > size_) {
+        if (new_size > Capacity()) {
+            Reserve(GrownCapacity(new_size));
+        }
+        std::uninitialized_default_construct_n(data_.GetAddress() + size_, new_size - size_);
     }
     size_ = new_size;
+    return data_.GetAddress() + old_size;
 }
 
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
+T* Vector<T, Alloc, Growth>::AppendUninitialized(size_t count) {
+    if (count > MaxCapacity() - size_) {
+        throw std::bad_array_new_length();
+    }
+    return ResizeDefaultInit(size_ + count);
+}
+
+template <typename T, typename Alloc, typename Growth>
 template <typename V>
-void Vector<T>::PushBack(V&& value) {
+void Vector<T, Alloc, Growth>::PushBack(V&& value) {
     EmplaceBack(std::forward<V>(value));        
 }   
 
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
 template <typename... Args>
-T& Vector<T>::EmplaceBack(Args&&... args) {
+T& Vector<T, Alloc, Growth>::EmplaceBack(Args&&... args) {
     return *Emplace(cend(), std::forward<Args>(args)...);        
 }   
 
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
 template <typename... Args>
-typename Vector<T>::iterator Vector<T>::Emplace(const_iterator pos, Args&&... args) {
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Emplace(const_iterator pos, Args&&... args) {
     auto distance = std::distance(cbegin(), pos);
     if (size_ == Capacity()) {            
         EmplaceWithReallocation(pos, std::forward<Args>(args)...);
@@ -181,85 +343,342 @@ typename Vector<T>::iterator Vector<T>::Emplace(const_iterator pos, Args&&... ar
     return begin()+distance;
 }
 
-template <typename T>
-typename Vector<T>::iterator Vector<T>::Erase(const_iterator pos) {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Erase(const_iterator pos) {
     auto distance = std::distance(cbegin(), pos);
-    std::move(begin()+distance+1, end(), begin()+distance);        
-    PopBack();        
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        std::destroy_at(begin() + distance);
+        TrivialRelocateOverlapping(begin() + distance + 1, size_ - distance - 1, begin() + distance);
+    } else {
+        std::move(begin()+distance+1, end(), begin()+distance);        
+        std::destroy_at(end() - 1);
+    }
+    --size_;
+    ShrinkIfSparse();
     return begin()+distance;
 }    
 
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Erase(const_iterator first, const_iterator last) {
+    const size_t distance = std::distance(cbegin(), first);
+    const size_t count = std::distance(first, last);
+    iterator erased = begin() + distance;
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        std::destroy_n(erased, count);
+        TrivialRelocateOverlapping(erased + count, size_ - distance - count, erased);
+    } else {
+        std::move(erased + count, end(), erased);
+        std::destroy_n(end() - count, count);
+    }
+    size_ -= count;
+    ShrinkIfSparse();
+    return begin() + distance;
+}
+
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::SwapErase(const_iterator pos) {
+    const size_t distance = std::distance(cbegin(), pos);
+    iterator erased = begin() + distance;
+    iterator last = end() - 1;
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        std::destroy_at(erased);
+        if (erased != last) {
+            TrivialRelocate(last, 1, erased);
+        }
+    } else {
+        if (erased != last) {
+            *erased = std::move(*last);
+        }
+        std::destroy_at(last);
+    }
+    --size_;
+    ShrinkIfSparse();
+    return begin() + distance;
+}
+
+template <typename T, typename Alloc, typename Growth>
 template <typename V>
-typename Vector<T>::iterator Vector<T>::Insert(const_iterator pos, V&& value) {
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, V&& value) {
     return Emplace(pos, std::forward<V>(value));
 }
 
-template <typename T>
-void Vector<T>::PopBack() {
+template <typename T, typename Alloc, typename Growth>
+template <typename InputIt, typename>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, InputIt first, InputIt last) {
+    using Category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (!std::is_base_of_v<std::forward_iterator_tag, Category>) {
+        // Single-pass input cannot be measured up front, so it is gathered first
+        Vector tmp(data_.GetAllocator());
+        for (; first != last; ++first) {
+            tmp.EmplaceBack(*first);
+        }
+        return Insert(pos, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+    } else {
+        const size_t count = std::distance(first, last);
+        if constexpr (std::is_pointer_v<InputIt> && kIsTriviallyRelocatable<T>) {
+            // The in-place path shifts the tail before copying, which would
+            // clobber a source range taken from this vector
+            if (count != 0 && (Contains(first) || Contains(first + count - 1))) {
+                Vector tmp(data_.GetAllocator());
+                tmp.Insert(tmp.cend(), first, last);
+                return Insert(pos, std::make_move_iterator(tmp.begin()), std::make_move_iterator(tmp.end()));
+            }
+        }
+        return InsertWith(pos, count, [&](T* dest) {
+            std::uninitialized_copy_n(first, count, dest);
+        });
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::Insert(const_iterator pos, size_t count, const T& value) {
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        if (Contains(&value)) {
+            const T copy(value);
+            return InsertWith(pos, count, [&](T* dest) {
+                std::uninitialized_fill_n(dest, count, copy);
+            });
+        }
+    }
+    return InsertWith(pos, count, [&](T* dest) {
+        std::uninitialized_fill_n(dest, count, value);
+    });
+}
+
+template <typename T, typename Alloc, typename Growth>
+template <typename Range>
+void Vector<T, Alloc, Growth>::Append(Range&& range) {
+    using std::begin;
+    using std::end;
+    if constexpr (std::is_rvalue_reference_v<Range&&> && !std::is_const_v<std::remove_reference_t<Range>>) {
+        Insert(cend(), std::make_move_iterator(begin(range)), std::make_move_iterator(end(range)));
+    } else {
+        Insert(cend(), begin(range), end(range));
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::PopBack() {
     std::destroy_n(data_.GetAddress() + size_ - 1, 1);
     --size_;
+    ShrinkIfSparse();
 }
 
-template <typename T>
-void Vector<T>::Reserve(size_t new_capacity) {
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Reserve(size_t new_capacity) {
     if (new_capacity <= data_.Capacity()) {
         return;
     }
-    RawMemory<T> new_data(new_capacity);
-    UninitializedMoveOrCopy(data_.GetAddress(), size_, new_data.GetAddress());
-    std::destroy_n(data_.GetAddress(), size_);
+    new_capacity = std::max(new_capacity, std::min(Growth::template Fit<T>(new_capacity), MaxCapacity()));
+    Reallocate(new_capacity);
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::ShrinkToFit() {
+    if (Capacity() > size_) {
+        Reallocate(size_);
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::Reallocate(size_t new_capacity) {
+    assert(new_capacity >= size_);
+    if (new_capacity == 0) {
+        RawMemory<T, Alloc> empty(data_.GetAllocator());
+        data_.Swap(empty);
+        return;
+    }
+    if (data_.ExtendInPlace(new_capacity)) {
+        return;
+    }
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        if (data_.TryReallocate(new_capacity)) {
+            return;
+        }
+    }
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        TrivialRelocate(data_.GetAddress(), size_, new_data.GetAddress());
+    } else {
+        UninitializedMoveOrCopy(data_.GetAddress(), size_, new_data.GetAddress());
+        std::destroy_n(data_.GetAddress(), size_);
+    }
     data_.Swap(new_data);
 }
 
-template <typename T>
-const T& Vector<T>::operator[](size_t index) const noexcept {
+template <typename T, typename Alloc, typename Growth>
+const T& Vector<T, Alloc, Growth>::operator[](size_t index) const noexcept {
     return const_cast<Vector&>(*this)[index];
 }
 
-template <typename T>
-T& Vector<T>::operator[](size_t index) noexcept {
+template <typename T, typename Alloc, typename Growth>
+T& Vector<T, Alloc, Growth>::operator[](size_t index) noexcept {
     assert(index < size_);
     return data_[index];
 }
 
-template <typename T>
-typename Vector<T>::iterator Vector<T>::begin() noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::begin() noexcept {
     return data_.GetAddress();
 }
 
-template <typename T>
-typename Vector<T>::iterator Vector<T>::end() noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::end() noexcept {
     return data_.GetAddress() + size_;
 }
 
-template <typename T>
-typename Vector<T>::const_iterator Vector<T>::begin() const noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::begin() const noexcept {
     return data_.GetAddress();
 }
 
-template <typename T>
-typename Vector<T>::const_iterator Vector<T>::end() const noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::end() const noexcept {
     return data_.GetAddress() + size_;
 }
 
-template <typename T>
-typename Vector<T>::const_iterator Vector<T>::cbegin() const noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::cbegin() const noexcept {
     return data_.GetAddress();
 }
 
-template <typename T>
-typename Vector<T>::const_iterator Vector<T>::cend() const noexcept {
+template <typename T, typename Alloc, typename Growth>
+typename Vector<T, Alloc, Growth>::const_iterator Vector<T, Alloc, Growth>::cend() const noexcept {
     return data_.GetAddress() + size_;
 }
 
-template <typename T>
-Vector<T>::~Vector() {        
+template <typename T, typename Alloc, typename Growth>
+Vector<T, Alloc, Growth>::~Vector() {        
     std::destroy_n(data_.GetAddress(), size_);
 }
 
-template <typename T>
-void Vector<T>::UninitializedMoveOrCopy(iterator from, int number_of_elements, iterator to) {
+template <typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::MaxCapacity() const noexcept {
+    return AllocTraits::max_size(data_.GetAllocator());
+}
+
+template <typename T, typename Alloc, typename Growth>
+size_t Vector<T, Alloc, Growth>::GrownCapacity(size_t required) const noexcept {
+    return std::max(required, std::min(Growth::template Grow<T>(Capacity(), required), MaxCapacity()));
+}
+
+template <typename T, typename Alloc, typename Growth>
+template <typename Pred>
+size_t Vector<T, Alloc, Growth>::CompactIf(Pred& pred) {
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        // Removed elements are destroyed in place and each run of kept
+        // elements is relocated with a single memmove
+        iterator out = std::find_if(begin(), end(), pred);
+        iterator it = out;
+        try {
+            while (it != end()) {
+                while (it != end() && pred(*it)) {
+                    std::destroy_at(it++);
+                }
+                iterator run_end = std::find_if(it, end(), pred);
+                TrivialRelocateOverlapping(it, run_end - it, out);
+                out += run_end - it;
+                it = run_end;
+            }
+        } catch (...) {
+            // Close the gap so that the vector stays consistent
+            TrivialRelocateOverlapping(it, end() - it, out);
+            size_ -= it - out;
+            throw;
+        }
+        const size_t removed = end() - out;
+        size_ -= removed;
+        ShrinkIfSparse();
+        return removed;
+    } else {
+        iterator new_end = std::remove_if(begin(), end(), pred);
+        const size_t removed = end() - new_end;
+        Erase(new_end, end());
+        return removed;
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::ShrinkIfSparse() noexcept {
+    if constexpr (HasShrinkPolicy<Growth, T>::value) {
+        const size_t target = std::max(Growth::template Shrink<T>(Capacity(), size_), size_);
+        if (target < Capacity()) {
+            try {
+                Reallocate(target);
+            } catch (...) {
+                // Keep the larger buffer
+            }
+        }
+    }
+}
+
+template <typename T, typename Alloc, typename Growth>
+bool Vector<T, Alloc, Growth>::Contains(const T* ptr) const noexcept {
+    return std::less_equal<const T*>()(cbegin(), ptr) && std::less<const T*>()(ptr, cend());
+}
+
+template <typename T, typename Alloc, typename Growth>
+template <typename Construct>
+typename Vector<T, Alloc, Growth>::iterator Vector<T, Alloc, Growth>::InsertWith(const_iterator pos, size_t count, Construct&& construct) {
+    const size_t distance = std::distance(cbegin(), pos);
+    if (count == 0) {
+        return begin() + distance;
+    }
+    if (count > MaxCapacity() - size_) {
+        throw std::bad_array_new_length();
+    }
+    const size_t new_size = size_ + count;
+    if (new_size > Capacity() && !data_.ExtendInPlace(GrownCapacity(new_size))) {
+        // New elements go straight into the new buffer, so the strong
+        // guarantee holds just like in EmplaceWithReallocation
+        RawMemory<T, Alloc> new_data(GrownCapacity(new_size), data_.GetAllocator());
+        construct(new_data.GetAddress() + distance);
+        if constexpr (kIsTriviallyRelocatable<T>) {
+            TrivialRelocate(begin(), distance, new_data.GetAddress());
+            TrivialRelocate(begin() + distance, size_ - distance, new_data.GetAddress() + distance + count);
+        } else {
+            try {
+                UninitializedMoveOrCopy(begin(), distance, new_data.GetAddress());
+            } catch (...) {
+                std::destroy_n(new_data.GetAddress() + distance, count);
+                throw;
+            }
+            try {
+                UninitializedMoveOrCopy(begin() + distance, size_ - distance, new_data.GetAddress() + distance + count);
+            } catch (...) {
+                std::destroy_n(new_data.GetAddress(), distance + count);
+                throw;
+            }
+            std::destroy_n(begin(), size_);
+        }
+        data_.Swap(new_data);
+    } else if constexpr (kIsTriviallyRelocatable<T>) {
+        TrivialRelocateOverlapping(begin() + distance, size_ - distance, begin() + distance + count);
+        try {
+            construct(begin() + distance);
+        } catch (...) {
+            TrivialRelocateOverlapping(begin() + distance + count, size_ - distance, begin() + distance);
+            throw;
+        }
+    } else {
+        // Built past the end first, so a throwing constructor leaves the
+        // vector untouched. A throwing move during the rotation only gives
+        // the basic guarantee: the elements may be permuted, and whatever
+        // sits past the end is destroyed.
+        construct(end());
+        try {
+            std::rotate(begin() + distance, end(), end() + count);
+        } catch (...) {
+            std::destroy_n(end(), count);
+            throw;
+        }
+    }
+    size_ = new_size;
+    return begin() + distance;
+}
+
+template <typename T, typename Alloc, typename Growth>
+void Vector<T, Alloc, Growth>::UninitializedMoveOrCopy(iterator from, size_t number_of_elements, iterator to) {
     if constexpr(std::is_nothrow_move_constructible_v<T> || !std::is_copy_constructible_v<T>) {           
         std::uninitialized_move_n(from, number_of_elements, to);
     } else {
@@ -267,11 +686,44 @@ void Vector<T>::UninitializedMoveOrCopy(iterator from, int number_of_elements, i
     }
 }
 
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
 template <typename... Args>
-void Vector<T>::EmplaceWithReallocation(const_iterator pos, Args&&... args) {
+void Vector<T, Alloc, Growth>::EmplaceWithReallocation(const_iterator pos, Args&&... args) {
+    // Also tells the compiler that size_ + 1 does not wrap around
+    if (size_ >= MaxCapacity()) {
+        throw std::bad_array_new_length();
+    }
+    const size_t new_capacity = GrownCapacity(size_ + 1);
+    if (data_.ExtendInPlace(new_capacity)) {
+        EmplaceWithoutReallocation(pos, std::forward<Args>(args)...);
+        return;
+    }
     auto distance = std::distance(cbegin(), pos);
-    RawMemory<T> new_data(size_ == 0 ? 1 : size_ * 2);            
+    if constexpr (kIsTriviallyRelocatable<T>) {
+        // The new element is built before the buffer can move, since `args`
+        // may refer to one of our elements.
+        alignas(T) std::byte tmp[sizeof(T)];
+        T* value = new(tmp) T(std::forward<Args>(args)...);
+        if (data_.TryReallocate(new_capacity)) {
+            TrivialRelocateOverlapping(begin() + distance, size_ - distance, begin() + distance + 1);
+            TrivialRelocate(value, 1, begin() + distance);
+            return;
+        }
+        RawMemory<T, Alloc> new_data = [&] {
+            try {
+                return RawMemory<T, Alloc>(new_capacity, data_.GetAllocator());
+            } catch (...) {
+                std::destroy_at(value);
+                throw;
+            }
+        }();
+        TrivialRelocate(begin(), distance, new_data.GetAddress());
+        TrivialRelocate(value, 1, new_data.GetAddress() + distance);
+        TrivialRelocate(begin() + distance, size_ - distance, new_data.GetAddress() + distance + 1);
+        data_.Swap(new_data);
+        return;
+    }
+    RawMemory<T, Alloc> new_data(new_capacity, data_.GetAllocator());            
     new(new_data + distance) T(std::forward<Args>(args)...);
 
     try {
@@ -292,12 +744,19 @@ void Vector<T>::EmplaceWithReallocation(const_iterator pos, Args&&... args) {
     std::destroy_n(new_data.GetAddress(), size_);
 }
     
-template <typename T>
+template <typename T, typename Alloc, typename Growth>
 template <typename... Args>
-void Vector<T>::EmplaceWithoutReallocation(const_iterator pos, Args&&... args) {
+void Vector<T, Alloc, Growth>::EmplaceWithoutReallocation(const_iterator pos, Args&&... args) {
     auto distance = std::distance(cbegin(), pos);
     if (pos == cend()) {
         new(data_.GetAddress() + size_) T(std::forward<Args>(args)...);
+    } else if constexpr (kIsTriviallyRelocatable<T>) {
+        // Built aside first, since `args` may refer to an element that is
+        // about to be shifted; its bytes are then relocated into the gap.
+        alignas(T) std::byte tmp[sizeof(T)];
+        T* value = new(tmp) T(std::forward<Args>(args)...);
+        TrivialRelocateOverlapping(begin() + distance, size_ - distance, begin() + distance + 1);
+        TrivialRelocate(value, 1, begin() + distance);
     } else {
         T tmp(std::forward<Args>(args)...);                       
         std::uninitialized_move_n(data_.GetAddress() + size_ - 1, 1, data_.GetAddress() + size_);                 
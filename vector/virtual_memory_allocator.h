@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "vector.h"
+
+// Configuration of a VirtualMemoryAllocator. Every buffer reserves
+// `max_reservation_bytes` of address space up front and makes it accessible
+// in steps of `commit_granularity` bytes (rounded up to whole pages).
+struct VirtualMemoryOptions {
+    size_t max_reservation_bytes = size_t{1} << 36;
+    size_t commit_granularity = size_t{1} << 21;
+};
+
+// VirtualMemoryAllocator backs each buffer with a PROT_NONE address range
+// reserved up front and commits pages as the buffer grows. Growth is served
+// entirely by the `try_extend` hook, so a Vector using it never relocates:
+// pointers and iterators stay valid until the reservation is exhausted.
+// Since the buffers are pinned, growth that cannot commit more pages (the
+// reservation is full, or mprotect fails under a commit or RLIMIT_DATA
+// limit) throws std::bad_alloc and leaves the vector unchanged. POSIX only.
+template <typename T>
+class VirtualMemoryAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using pinned_buffers = std::true_type;
+
+    explicit VirtualMemoryAllocator(const VirtualMemoryOptions& options = {}) noexcept;
+
+    template <typename U>
+    VirtualMemoryAllocator(const VirtualMemoryAllocator<U>& other) noexcept
+        : options_(other.options_) {}
+
+    T* allocate(size_t n);
+    void deallocate(T* p, size_t n) noexcept;
+
+    // Commits or decommits pages so that [p, p + new_n) is accessible
+    bool try_extend(T* p, size_t old_n, size_t new_n) noexcept;
+
+    // Largest number of elements a single buffer can hold
+    size_t MaxCapacity() const noexcept { return options_.max_reservation_bytes / sizeof(T); }
+    size_t max_size() const noexcept { return MaxCapacity(); }
+    const VirtualMemoryOptions& Options() const noexcept { return options_; }
+
+    template <typename U>
+    bool operator==(const VirtualMemoryAllocator<U>& other) const noexcept {
+        return options_.max_reservation_bytes == other.options_.max_reservation_bytes
+            && options_.commit_granularity == other.options_.commit_granularity;
+    }
+
+    template <typename U>
+    bool operator!=(const VirtualMemoryAllocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    template <typename U>
+    friend class VirtualMemoryAllocator;
+
+    size_t CommittedBytes(size_t n) const noexcept;
+
+    VirtualMemoryOptions options_;
+};
+
+// Vector whose elements never move on growth
+template <typename T>
+using ReservedVector = Vector<T, VirtualMemoryAllocator<T>>;
+
+
+// Implementation of VirtualMemoryAllocator class template methods
+
+
+template <typename T>
+VirtualMemoryAllocator<T>::VirtualMemoryAllocator(const VirtualMemoryOptions& options) noexcept
+    : options_(options) {
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto round = [page_size](size_t bytes) {
+        return (bytes + page_size - 1) / page_size * page_size;
+    };
+    options_.commit_granularity = round(options_.commit_granularity == 0 ? page_size : options_.commit_granularity);
+    options_.max_reservation_bytes = round(options_.max_reservation_bytes);
+}
+
+template <typename T>
+T* VirtualMemoryAllocator<T>::allocate(size_t n) {
+    if (n > MaxCapacity()) {
+        throw std::bad_alloc();
+    }
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    void* reservation = mmap(nullptr, options_.max_reservation_bytes, PROT_NONE, flags, -1, 0);
+    if (reservation == MAP_FAILED) {
+        throw std::bad_alloc();
+    }
+    if (mprotect(reservation, CommittedBytes(n), PROT_READ | PROT_WRITE) != 0) {
+        munmap(reservation, options_.max_reservation_bytes);
+        throw std::bad_alloc();
+    }
+    return static_cast<T*>(reservation);
+}
+
+template <typename T>
+void VirtualMemoryAllocator<T>::deallocate(T* p, size_t /*n*/) noexcept {
+    munmap(p, options_.max_reservation_bytes);
+}
+
+template <typename T>
+bool VirtualMemoryAllocator<T>::try_extend(T* p, size_t old_n, size_t new_n) noexcept {
+    if (new_n > MaxCapacity()) {
+        return false;
+    }
+    const size_t old_bytes = CommittedBytes(old_n);
+    const size_t new_bytes = CommittedBytes(new_n);
+    auto* base = reinterpret_cast<std::byte*>(p);
+    if (new_bytes > old_bytes) {
+        return mprotect(base + old_bytes, new_bytes - old_bytes, PROT_READ | PROT_WRITE) == 0;
+    }
+    if (new_bytes < old_bytes) {
+        // Give the physical pages back but keep the address range reserved
+        madvise(base + new_bytes, old_bytes - new_bytes, MADV_DONTNEED);
+        mprotect(base + new_bytes, old_bytes - new_bytes, PROT_NONE);
+    }
+    return true;
+}
+
+template <typename T>
+size_t VirtualMemoryAllocator<T>::CommittedBytes(size_t n) const noexcept {
+    const size_t granularity = options_.commit_granularity;
+    const size_t bytes = (n * sizeof(T) + granularity - 1) / granularity * granularity;
+    return bytes < options_.max_reservation_bytes ? bytes : options_.max_reservation_bytes;
+}